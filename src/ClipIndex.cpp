@@ -0,0 +1,246 @@
+#include "ClipIndex.h"
+#include "Util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG  ofLogVerbose("ClipIndex")
+#define ERR  ofLogError("ClipIndex")
+
+// Layout of an index file: the header, then the time of each frame
+// (double, sorted) and the frame index of each keyframe (int32)
+static const char MAGIC[8] = {'C', 'L', 'I', 'P', 'I', 'D', 'X', '1'};
+
+struct IndexHeader {
+    char magic[8];
+    uint64_t clipSize;
+    int64_t clipMtime;
+    double duration;
+    double frameRate;
+    int32_t width;
+    int32_t height;
+    int32_t numFrames;
+    int32_t numKeys;
+    char codec[16];
+};
+
+static bool readLines(const string &cmd, vector<string> &lines) {
+    // runs cmd, returns its output split in lines
+    FILE *p = popen(cmd.c_str(), "r");
+    if(p == nullptr)
+        return false;
+    lines.clear();
+    string line;
+    char buf[256];
+    while(fgets(buf, sizeof(buf), p) != nullptr) {
+        line += buf;
+        if(!line.empty() && line.back() == '\n') {
+            line.pop_back();
+            lines.push_back(line);
+            line.clear();
+        }
+    }
+    if(!line.empty())
+        lines.push_back(line);
+    return pclose(p) == 0;
+}
+
+ClipInfo::ClipInfo() {
+    duration = 0;
+    numFrames = 0;
+    frameRate = 0;
+    width = 0;
+    height = 0;
+    times = nullptr;
+    keys = nullptr;
+    numKeys = 0;
+}
+
+double ClipInfo::frameTime(int frame) const {
+    if(times == nullptr || frame < 0 || frame >= numFrames)
+        return -1;
+    // streams may start at a non-zero timestamp (edit lists, transport
+    // streams). Players count from the first frame
+    return times[frame] - times[0];
+}
+
+int ClipInfo::frameAt(double secs) const {
+    if(times == nullptr)
+        return -1;
+    // the last frame starting at or before secs. The tolerance absorbs
+    // the rounding of positions reported by the player
+    auto it = upper_bound(times, times + numFrames, times[0] + secs + 0.0005);
+    int frame = static_cast<int>(it - times) - 1;
+    return frame < 0 ? 0 : frame;
+}
+
+int ClipInfo::keyframeBefore(int frame) const {
+    if(keys == nullptr)
+        return -1;
+    auto it = upper_bound(keys, keys + numKeys, frame);
+    return it == keys ? -1 : *(it - 1);
+}
+
+ClipIndex::~ClipIndex() {
+    stop();
+}
+
+void ClipIndex::setup(const string &dir_) {
+    dir = dir_;
+}
+
+string ClipIndex::indexPath(const string &clip) const {
+    // named after the absolute path of the clip, FNV-1a
+    string abs = ofFilePath::getAbsolutePath(clip, false);
+    uint64_t h = fnv1a(abs.data(), abs.size());
+    string d = dir.empty()
+            ? ofFilePath::join(ofFilePath::getEnclosingDirectory(clip, false), ".clipindex")
+            : dir;
+    stringstream name;
+    name << ofFilePath::getBaseName(clip) << "." << hex << h << ".idx";
+    return ofFilePath::join(d, name.str());
+}
+
+bool ClipIndex::lookup(const string &clip, ClipInfo &info) const {
+    struct stat st;
+    if(stat(clip.c_str(), &st) != 0)
+        return false;
+    int fd = open(indexPath(clip).c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat ist;
+    void *data = MAP_FAILED;
+    if(fstat(fd, &ist) == 0 && static_cast<size_t>(ist.st_size) >= sizeof(IndexHeader))
+        data = mmap(nullptr, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return false;
+    size_t size = static_cast<size_t>(ist.st_size);
+    shared_ptr<void> mapping(data, [size](void *p) { munmap(p, size); });
+    auto h = static_cast<const IndexHeader*>(data);
+    if(memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->numFrames <= 0 || h->numKeys < 0)
+        return false;
+    size_t expected = sizeof(IndexHeader) + h->numFrames * sizeof(double) +
+                      h->numKeys * sizeof(int32_t);
+    if(expected != size)
+        return false;
+    // the clip changed since the index was built
+    if(h->clipSize != static_cast<uint64_t>(st.st_size) || h->clipMtime != st.st_mtime)
+        return false;
+    info.mapping = mapping;
+    info.duration = static_cast<float>(h->duration);
+    info.numFrames = h->numFrames;
+    info.frameRate = static_cast<float>(h->frameRate);
+    info.width = h->width;
+    info.height = h->height;
+    info.codec = string(h->codec, strnlen(h->codec, sizeof(h->codec)));
+    info.times = reinterpret_cast<const double*>(h + 1);
+    info.keys = reinterpret_cast<const int32_t*>(info.times + h->numFrames);
+    info.numKeys = static_cast<size_t>(h->numKeys);
+    return true;
+}
+
+void ClipIndex::add(size_t slot, const string &clip) {
+    if(!isThreadRunning())
+        startThread();
+    pending.send(IndexJob{slot, clip, false});
+}
+
+bool ClipIndex::poll(IndexJob &job) {
+    return done.tryReceive(job);
+}
+
+void ClipIndex::stop() {
+    pending.close();
+    done.close();
+    if(isThreadRunning())
+        waitForThread(true);
+}
+
+bool ClipIndex::build(const string &clip) {
+    struct stat st;
+    if(stat(clip.c_str(), &st) != 0)
+        return false;
+    string quoted = shellQuote(clip);
+    vector<string> lines;
+    if(!readLines("ffprobe -v error -select_streams v:0 -show_entries "
+                  "stream=codec_name,width,height,avg_frame_rate:format=duration "
+                  "-of default=nw=1 " + quoted, lines))
+        return false;
+    map<string, string> values;
+    for(const auto &line: lines) {
+        auto eq = line.find('=');
+        if(eq != string::npos)
+            values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    // packets in decode order, pts_time,flags. K marks a keyframe
+    if(!readLines("ffprobe -v error -select_streams v:0 -show_entries packet=pts_time,flags "
+                  "-of csv=p=0 " + quoted, lines))
+        return false;
+    vector<double> times;
+    vector<double> keyTimes;
+    for(const auto &line: lines) {
+        auto fields = ofSplitString(line, ",");
+        if(fields.size() < 2 || fields[0] == "N/A" || fields[0].empty())
+            continue;
+        double t = ofToDouble(fields[0]);
+        times.push_back(t);
+        if(!fields[1].empty() && fields[1][0] == 'K')
+            keyTimes.push_back(t);
+    }
+    if(times.empty())
+        return false;
+    sort(times.begin(), times.end());
+    vector<int32_t> keys;
+    for(double t: keyTimes)
+        keys.push_back(static_cast<int32_t>(lower_bound(times.begin(), times.end(), t) - times.begin()));
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    IndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.clipSize = static_cast<uint64_t>(st.st_size);
+    h.clipMtime = st.st_mtime;
+    auto rate = ofSplitString(values["avg_frame_rate"], "/");
+    if(rate.size() == 2 && ofToDouble(rate[1]) > 0)
+        h.frameRate = ofToDouble(rate[0]) / ofToDouble(rate[1]);
+    h.duration = values.count("duration") ? ofToDouble(values["duration"]) : 0;
+    if(h.duration <= 0)
+        h.duration = times.back() + (h.frameRate > 0 ? 1 / h.frameRate : 0);
+    h.width = ofToInt(values["width"]);
+    h.height = ofToInt(values["height"]);
+    h.numFrames = static_cast<int32_t>(times.size());
+    h.numKeys = static_cast<int32_t>(keys.size());
+    strncpy(h.codec, values["codec_name"].c_str(), sizeof(h.codec) - 1);
+
+    // written under a temporary name, so that a half written index is
+    // never mapped
+    string path = indexPath(clip);
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(path, false), false, true);
+    string part = path + ".part";
+    {
+        ofstream f(part, ios::binary | ios::trunc);
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(reinterpret_cast<const char*>(times.data()), times.size() * sizeof(double));
+        f.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(int32_t));
+        if(!f)
+            return false;
+    }
+    return ofFile::moveFromTo(part, path, false, true);
+}
+
+void ClipIndex::threadedFunction() {
+    IndexJob job;
+    while(pending.receive(job)) {
+        uint64_t t0 = ofGetElapsedTimeMillis();
+        job.ok = build(job.clip);
+        if(job.ok)
+            LOG << "indexed " << job.clip << " (" << ofGetElapsedTimeMillis() - t0 << " ms)";
+        else
+            ERR << "could not index " << job.clip << ", is ffprobe installed?";
+        done.send(job);
+    }
+}
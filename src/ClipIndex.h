@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ofMain.h"
+
+// What is known about a clip without opening it: its metadata and the
+// presentation time of every frame, with the keyframes among them. Backed
+// by a memory mapped index file, see ClipIndex
+class ClipInfo {
+
+public:
+    ClipInfo();
+    bool valid() const { return numFrames > 0; }
+    // secs from the first frame, -1 if unknown
+    double frameTime(int frame) const;
+    // the frame shown at secs from the first frame, -1 if unknown
+    int frameAt(double secs) const;
+    // the last keyframe at or before frame, -1 if unknown
+    int keyframeBefore(int frame) const;
+    size_t numKeyframes() const { return numKeys; }
+
+    float duration;
+    int numFrames;
+    float frameRate;
+    int width;
+    int height;
+    string codec;
+
+private:
+    friend class ClipIndex;
+    shared_ptr<void> mapping;
+    const double *times;        // numFrames, sorted
+    const int32_t *keys;        // numKeys, ascending frame indices
+    size_t numKeys;
+};
+
+struct IndexJob {
+    size_t slot;
+    string clip;
+    bool ok;
+};
+
+// Index files of clips, one per clip, in dir or in .clipindex next to the
+// clip. A file is valid as long as the size and mtime of its clip are the
+// same as when it was built. Building reads the packet table of the clip
+// with ffprobe, without decoding, on a background thread. Requires
+// ffprobe in the PATH
+class ClipIndex : public ofThread {
+
+public:
+    ~ClipIndex();
+    void setup(const string &dir_);
+    bool lookup(const string &clip, ClipInfo &info) const;
+    void add(size_t slot, const string &clip);
+    bool poll(IndexJob &job);
+    void stop();
+
+protected:
+    void threadedFunction();
+
+private:
+    string indexPath(const string &clip) const;
+    bool build(const string &clip);
+    string dir;
+    ofThreadChannel<IndexJob> pending;
+    ofThreadChannel<IndexJob> done;
+};
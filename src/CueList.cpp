@@ -0,0 +1,66 @@
+#include "CueList.h"
+
+#define ERR  ofLogError("CueList")
+
+CueList::CueList() {
+    clear();
+}
+
+void CueList::clear() {
+    points.clear();
+    loopIn = 0;
+    loopOut = 0;
+}
+
+bool CueList::find(const string &name, float &time) const {
+    auto it = points.find(name);
+    if(it != points.end()) {
+        time = it->second;
+        return true;
+    }
+    // a number is a time of its own
+    char *end = nullptr;
+    float t = strtof(name.c_str(), &end);
+    if(name.empty() || *end != '\0')
+        return false;
+    time = t;
+    return true;
+}
+
+bool CueList::load(const string &path) {
+    clear();
+    ifstream f(path);
+    if(!f)
+        return false;
+    // the loop may refer to cues defined further down
+    string loopFrom, loopTo;
+    string line;
+    size_t lineno = 0;
+    while(getline(f, line)) {
+        lineno++;
+        istringstream ss(line);
+        vector<string> tokens{istream_iterator<string>(ss), istream_iterator<string>()};
+        if(tokens.empty() || tokens[0][0] == '#')
+            continue;
+        if(tokens[0] == "loop" && tokens.size() == 3) {
+            loopFrom = tokens[1];
+            loopTo = tokens[2];
+            continue;
+        }
+        float time;
+        if(tokens.size() != 2 || !find(tokens[1], time)) {
+            ERR << path << ":" << lineno << ": expected <name> <secs> or loop <in> <out>";
+            continue;
+        }
+        points[tokens[0]] = time;
+    }
+    if(!loopFrom.empty() && (!find(loopFrom, loopIn) || !find(loopTo, loopOut))) {
+        ERR << path << ": unknown cue in loop " << loopFrom << " " << loopTo;
+        loopIn = loopOut = 0;
+    }
+    return true;
+}
+
+string cueFilePath(const string &clipPath) {
+    return ofFilePath::removeExt(clipPath) + ".cues";
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Named cue points and a loop region of a clip, in secs. Read from a
+// sidecar file next to the clip (clip.mp4 -> clip.cues), one entry per
+// line:
+//
+//     <name> <secs>
+//     loop <in> <out>
+//
+// in and out of the loop are secs or names of cues. Lines starting with
+// # are comments
+class CueList {
+
+public:
+    CueList();
+    void clear();
+    bool load(const string &path);
+    bool find(const string &name, float &time) const;
+    // no loop unless out > in
+    bool looping() const { return loopOut > loopIn; }
+    map<string, float> points;
+    float loopIn;
+    float loopOut;
+};
+
+string cueFilePath(const string &clipPath);
@@ -0,0 +1,73 @@
+#include "FolderWatch.h"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define LOG  ofLogVerbose("FolderWatch")
+#define ERR  ofLogError("FolderWatch")
+
+FolderWatch::FolderWatch() {
+    fd = -1;
+    settle = 500;
+}
+
+FolderWatch::~FolderWatch() {
+    close();
+}
+
+bool FolderWatch::setup(const string &dir_, uint64_t settle_) {
+    close();
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd < 0) {
+        ERR << "inotify_init1: " << strerror(errno);
+        return false;
+    }
+    // IN_CLOSE_WRITE: finished writing. IN_MOVED_TO: renamed into the
+    // folder, which is how most tools replace a file atomically
+    uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    if(inotify_add_watch(fd, dir_.c_str(), mask) < 0) {
+        ERR << "could not watch " << dir_ << ": " << strerror(errno);
+        close();
+        return false;
+    }
+    dir = dir_;
+    settle = settle_;
+    LOG << "watching " << dir;
+    return true;
+}
+
+void FolderWatch::close() {
+    if(fd >= 0)
+        ::close(fd);
+    fd = -1;
+    changed.clear();
+}
+
+vector<string> FolderWatch::poll() {
+    vector<string> settled;
+    if(fd < 0)
+        return settled;
+    uint64_t now = ofGetElapsedTimeMillis();
+    alignas(inotify_event) char buf[4096];
+    while(true) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if(len <= 0)
+            break;
+        for(char *p = buf; p < buf + len; ) {
+            auto ev = reinterpret_cast<const inotify_event*>(p);
+            if(ev->len > 0 && !(ev->mask & IN_ISDIR))
+                changed[ev->name] = now;
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+    auto it = changed.begin();
+    while(it != changed.end()) {
+        if(now - it->second >= settle) {
+            settled.push_back(it->first);
+            it = changed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return settled;
+}
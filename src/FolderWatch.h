@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Reports files of a folder which were added, rewritten, renamed or
+// removed, using inotify. A file is reported once it has not changed for
+// settle ms, so that files still being written (copied over the network,
+// exported) are not picked up half way. Polled from the render thread,
+// never blocks
+class FolderWatch {
+
+public:
+    FolderWatch();
+    ~FolderWatch();
+    bool setup(const string &dir_, uint64_t settle_);
+    void close();
+    bool watching() const { return fd >= 0; }
+    const string &path() const { return dir; }
+    // names of the files which changed and have settled since the last call
+    vector<string> poll();
+
+private:
+    int fd;
+    string dir;
+    uint64_t settle;                // ms
+    map<string, uint64_t> changed;  // name -> time of its last event, ms
+};
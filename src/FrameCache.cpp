@@ -0,0 +1,78 @@
+#include "FrameCache.h"
+
+FrameCache::FrameCache() {
+    cap = 0;
+}
+
+void FrameCache::setup(size_t capacity_) {
+    clear();
+    cap = capacity_;
+}
+
+void FrameCache::clear() {
+    index.clear();
+    pool.clear();
+}
+
+void FrameCache::store(int frame, const ofBaseDraws &src, int playhead) {
+    // the current frame of src (a player) is copied into the slot for frame
+    if(cap == 0 || has(frame))
+        return;
+    size_t pos;
+    if(pool.size() < cap) {
+        pool.push_back(ofFbo());
+        pos = pool.size() - 1;
+    } else {
+        // frames are ordered, so the one furthest from the playhead is
+        // either the first or the last
+        auto first = index.begin();
+        auto last = prev(index.end());
+        auto victim = abs(first->first - playhead) > abs(last->first - playhead) ? first : last;
+        pos = victim->second;
+        index.erase(victim);
+    }
+    auto &fbo = pool[pos];
+    int w = static_cast<int>(src.getWidth());
+    int h = static_cast<int>(src.getHeight());
+    if(!fbo.isAllocated() || fbo.getWidth() != w || fbo.getHeight() != h)
+        fbo.allocate(w, h, GL_RGB);
+    fbo.begin();
+    ofClear(0, 0, 0, 255);
+    src.draw(0, 0, w, h);
+    fbo.end();
+    index[frame] = pos;
+}
+
+size_t FrameCache::memory() const {
+    size_t bytes = 0;
+    for(const auto &fbo: pool)
+        bytes += static_cast<size_t>(fbo.getWidth() * fbo.getHeight() * 3);
+    return bytes;
+}
+
+int FrameCache::missingAround(int playhead, int numFrames) const {
+    // Returns the frame closest to the playhead within the cache window
+    // which has not been decoded yet, or -1 if the window is complete.
+    // Frames ahead of the playhead are preferred, since they can be
+    // reached by decoding forward without a seek
+    int half = static_cast<int>(cap / 2);
+    for(int d = 0; d <= half; d++) {
+        int ahead = playhead + d;
+        if(ahead < numFrames && !has(ahead))
+            return ahead;
+        int behind = playhead - d;
+        if(d > 0 && behind >= 0 && !has(behind))
+            return behind;
+    }
+    return -1;
+}
+
+int FrameCache::firstMissing(int from, int to) const {
+    // the first frame in [from, to] which has not been decoded yet, or -1.
+    // Decoding from there on is a forward run without seeks
+    for(int frame = max(from, 0); frame <= to; frame++) {
+        if(!has(frame))
+            return frame;
+    }
+    return -1;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <map>
+
+#include "ofMain.h"
+
+// A ring of decoded frames of one clip, kept as textures and keyed by
+// frame index. When full, the frame furthest away from the playhead is
+// recycled, so the cache always holds a window around the playhead.
+class FrameCache {
+
+public:
+    FrameCache();
+    void setup(size_t capacity_);
+    void clear();
+
+    bool has(int frame) const { return index.count(frame) > 0; }
+    const ofFbo & get(int frame) const { return pool[index.at(frame)]; }
+    void store(int frame, const ofBaseDraws &src, int playhead);
+    int missingAround(int playhead, int numFrames) const;
+    int firstMissing(int from, int to) const;
+
+    size_t size() const { return index.size(); }
+    size_t capacity() const { return cap; }
+    size_t memory() const;      // bytes used by the textures
+    bool enabled() const { return cap > 0; }
+
+private:
+    size_t cap;
+    vector<ofFbo> pool;
+    map<int, size_t> index;    // frame -> position in pool
+};
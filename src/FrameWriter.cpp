@@ -0,0 +1,74 @@
+#include "FrameWriter.h"
+
+#include <unistd.h>
+
+#define ERR  ofLogError("FrameWriter")
+
+int FrameWriter::stdoutFd = -1;
+
+FrameWriter::FrameWriter() {
+    out = nullptr;
+    frames = 0;
+}
+
+FrameWriter::~FrameWriter() {
+    close();
+}
+
+bool FrameWriter::takeStdout() {
+    // Keep the real stdout for the frames. Anything else printed to stdout
+    // (logs, the manual) is sent to stderr from now on, so that it does not
+    // end up in the stream. Called from main before anything is logged
+    if(stdoutFd >= 0)
+        return true;
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if(fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        ERR << "could not redirect stdout";
+        if(fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    stdoutFd = fd;
+    return true;
+}
+
+bool FrameWriter::open(const string &path) {
+    close();
+    if(path == "-") {
+        if(!takeStdout())
+            return false;
+        out = fdopen(stdoutFd, "wb");
+        if(out != nullptr)
+            stdoutFd = -1;
+    } else {
+        // a named pipe blocks here until there is a reader
+        out = fopen(path.c_str(), "wb");
+    }
+    if(out == nullptr) {
+        ERR << "could not open " << path << " for writing";
+        return false;
+    }
+    frames = 0;
+    return true;
+}
+
+void FrameWriter::close() {
+    if(out != nullptr)
+        fclose(out);
+    out = nullptr;
+}
+
+bool FrameWriter::write(const ofPixels &pixels) {
+    if(out == nullptr)
+        return false;
+    size_t n = pixels.getTotalBytes();
+    if(fwrite(pixels.getData(), 1, n, out) != n) {
+        // the reader went away
+        ERR << "write failed after " << frames << " frames";
+        close();
+        return false;
+    }
+    frames++;
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+#include "ofMain.h"
+
+// Writes rendered frames as raw rgb24, one after the other and without
+// any header, to a file, a named pipe or stdout ("-"). The stream can be
+// read with ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r fps -i <path>
+class FrameWriter {
+
+public:
+    FrameWriter();
+    ~FrameWriter();
+    bool open(const string &path);
+    void close();
+    bool write(const ofPixels &pixels);
+    static bool takeStdout();
+
+    bool isOpen() const { return out != nullptr; }
+    uint64_t numFrames() const { return frames; }
+
+private:
+    FILE *out;
+    uint64_t frames;
+    static int stdoutFd;    // the real stdout once taken, -1 if not
+};
@@ -0,0 +1,62 @@
+#include "MasterClock.h"
+
+#include <cmath>
+
+// a message this far from the estimate is a locate, not drift (secs)
+static const double LOCATE_THRESHOLD = 0.25;
+// fraction of the error corrected by each message
+static const double PHASE_GAIN = 0.1;
+static const double RATE_GAIN = 0.05;
+
+MasterClock::MasterClock() {
+    timeout = 2000000;
+    reset();
+}
+
+void MasterClock::reset() {
+    started = false;
+    base = 0;
+    baseAt = 0;
+    rate_ = 1;
+    lastTime = 0;
+    lastAt = 0;
+}
+
+void MasterClock::update(double t, uint64_t at) {
+    if(!started || !valid(at)) {
+        started = true;
+        base = t;
+        baseAt = at;
+        rate_ = 1;
+        lastTime = t;
+        lastAt = at;
+        return;
+    }
+    double err = t - time(at);
+    double dt = (static_cast<double>(at) - static_cast<double>(lastAt)) / 1000000.0;
+    if(fabs(err) > LOCATE_THRESHOLD) {
+        // the rate is kept: a locate while playing goes on playing
+        base = t;
+    } else {
+        base = time(at) + err * PHASE_GAIN;
+        if(t == lastTime) {
+            // the transport stopped: it keeps sending the same time
+            rate_ = 0;
+        } else if(dt > 0.001) {
+            double measured = (t - lastTime) / dt;
+            rate_ = rate_ == 0 ? measured : rate_ + (measured - rate_) * RATE_GAIN;
+        }
+    }
+    baseAt = at;
+    lastTime = t;
+    lastAt = at;
+}
+
+bool MasterClock::valid(uint64_t now) const {
+    return started && (now < lastAt || now - lastAt < timeout);
+}
+
+double MasterClock::time(uint64_t now) const {
+    double dt = (static_cast<double>(now) - static_cast<double>(baseAt)) / 1000000.0;
+    return base + dt * rate_;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// Estimate of an external timebase (the transport of a DAW, for ex.)
+// from the time messages it sends. Between messages the time is
+// extrapolated at the rate measured from the messages themselves, and
+// each new message only pulls the estimate part of the way, so that
+// network jitter does not show up as jumps. A message far off the
+// estimate is taken as a locate and followed right away
+class MasterClock {
+
+public:
+    MasterClock();
+    void reset();
+    // the master was at time (secs) at local time at (us, OscInput::now)
+    void update(double time, uint64_t at);
+    // true if a message arrived within the timeout
+    bool valid(uint64_t now) const;
+    double time(uint64_t now) const;
+    double rate() const { return rate_; }
+    uint64_t timeout;       // us
+
+private:
+    bool started;
+    double base;            // estimated master time at baseAt
+    uint64_t baseAt;
+    double rate_;           // master secs per local sec, 0 when stopped
+    double lastTime;        // last message
+    uint64_t lastAt;
+};
@@ -0,0 +1,157 @@
+#include "OscInput.h"
+
+#define ERR  ofLogError("OscInput")
+#define WARN ofLogWarning("OscInput")
+
+// seconds between the NTP epoch (1900) and the unix epoch (1970)
+static const uint64_t NTP_UNIX_OFFSET = 2208988800ULL;
+// furthest a bundle is scheduled ahead or behind, in microseconds
+static const int64_t MAX_SCHEDULE_AHEAD = 5000000;
+
+OscInput::OscInput() : batches(4096) {
+    running = false;
+    numDropped = 0;
+}
+
+OscInput::~OscInput() {
+    stop();
+}
+
+bool OscInput::setup(int port) {
+    stop();
+    try {
+        socket.reset(new UdpListeningReceiveSocket(
+                         IpEndpointName(IpEndpointName::ANY_ADDRESS, port), this));
+    } catch(std::exception &e) {
+        ERR << "could not listen on port " << port << ": " << e.what();
+        return false;
+    }
+    running = true;
+    listenThread = std::thread([this] {
+        while(running) {
+            try {
+                socket->Run();
+            } catch(std::exception &e) {
+                WARN << e.what();
+            }
+        }
+    });
+    return true;
+}
+
+void OscInput::stop() {
+    if(!running)
+        return;
+    running = false;
+    socket->AsynchronousBreak();
+    if(listenThread.joinable())
+        listenThread.join();
+    socket.reset();
+}
+
+bool OscInput::next(OscBatch &batch) {
+    return batches.pop(batch);
+}
+
+void OscInput::push(OscBatch &&batch) {
+    // called from the listening thread only
+    if(!batches.push(std::move(batch))) {
+        numDropped++;
+        WARN << "queue full, dropping message";
+    }
+}
+
+uint64_t OscInput::now() {
+    return chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t OscInput::timetagToLocal(uint64_t timetag) {
+    // A timetag is NTP time: seconds since 1900 in the upper 32 bits,
+    // fraction of a second in the lower 32. 1 means immediately. Done in
+    // signed arithmetic so that tags before 1970 don't wrap around
+    if(timetag <= 1)
+        return 0;
+    int64_t secs = static_cast<int64_t>(timetag >> 32) - static_cast<int64_t>(NTP_UNIX_OFFSET);
+    int64_t frac = static_cast<int64_t>(((timetag & 0xFFFFFFFFULL) * 1000000ULL) >> 32);
+    int64_t tagMicros = secs * 1000000 + frac;
+    int64_t wallMicros = chrono::duration_cast<chrono::microseconds>(
+                chrono::system_clock::now().time_since_epoch()).count();
+    int64_t local = static_cast<int64_t>(now());
+    int64_t delay = tagMicros - wallMicros;
+    // a tag long past (a sender with a wrong clock) is applied now, one
+    // too far ahead is held for at most MAX_SCHEDULE_AHEAD
+    if(delay < -MAX_SCHEDULE_AHEAD)
+        return static_cast<uint64_t>(local);
+    if(delay > MAX_SCHEDULE_AHEAD) {
+        WARN << "bundle timetag " << delay / 1000000 << " s ahead, scheduling it in "
+             << MAX_SCHEDULE_AHEAD / 1000000 << " s";
+        delay = MAX_SCHEDULE_AHEAD;
+    }
+    return static_cast<uint64_t>(max<int64_t>(local + delay, 0));
+}
+
+uint64_t OscInput::localToTimetag(uint64_t local) {
+    // inverse of timetagToLocal: NTP time of a now() time
+    int64_t wallMicros = chrono::duration_cast<chrono::microseconds>(
+                chrono::system_clock::now().time_since_epoch()).count();
+    int64_t micros = wallMicros + (static_cast<int64_t>(local) - static_cast<int64_t>(now()));
+    uint64_t secs = static_cast<uint64_t>(micros / 1000000) + NTP_UNIX_OFFSET;
+    uint64_t frac = (static_cast<uint64_t>(micros % 1000000) << 32) / 1000000ULL;
+    return (secs << 32) | frac;
+}
+
+void OscInput::ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint) {
+    OscBatch batch;
+    batch.received = now();
+    batch.messages.push_back(convert(m, remoteEndpoint));
+    batch.due = 0;
+    push(std::move(batch));
+}
+
+void OscInput::ProcessBundle(const osc::ReceivedBundle &b, const IpEndpointName &remoteEndpoint) {
+    // nested bundles are flattened into the outermost one
+    OscBatch batch;
+    batch.received = now();
+    collect(b, remoteEndpoint, batch.messages);
+    batch.due = timetagToLocal(b.TimeTag());
+    if(!batch.messages.empty())
+        push(std::move(batch));
+}
+
+void OscInput::collect(const osc::ReceivedBundle &b, const IpEndpointName &remoteEndpoint,
+                       vector<ofxOscMessage> &messages) {
+    for(auto it = b.ElementsBegin(); it != b.ElementsEnd(); ++it) {
+        if(it->IsBundle())
+            collect(osc::ReceivedBundle(*it), remoteEndpoint, messages);
+        else
+            messages.push_back(convert(osc::ReceivedMessage(*it), remoteEndpoint));
+    }
+}
+
+ofxOscMessage OscInput::convert(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint) {
+    ofxOscMessage msg;
+    char host[IpEndpointName::ADDRESS_STRING_LENGTH];
+    remoteEndpoint.AddressAsString(host);
+    msg.setAddress(m.AddressPattern());
+    msg.setRemoteEndpoint(host, remoteEndpoint.port);
+    for(auto arg = m.ArgumentsBegin(); arg != m.ArgumentsEnd(); ++arg) {
+        if(arg->IsInt32())
+            msg.addIntArg(arg->AsInt32Unchecked());
+        else if(arg->IsFloat())
+            msg.addFloatArg(arg->AsFloatUnchecked());
+        else if(arg->IsString())
+            msg.addStringArg(arg->AsStringUnchecked());
+        else if(arg->IsSymbol())
+            msg.addStringArg(arg->AsSymbolUnchecked());
+        else if(arg->IsInt64())
+            msg.addInt64Arg(arg->AsInt64Unchecked());
+        else if(arg->IsDouble())
+            msg.addDoubleArg(arg->AsDoubleUnchecked());
+        else if(arg->IsBool())
+            msg.addBoolArg(arg->AsBoolUnchecked());
+        else
+            WARN << m.AddressPattern() << ": ignoring argument of unsupported type";
+    }
+    return msg;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "SpscQueue.h"
+
+// Messages which have to be applied together, in the same frame. A
+// message received outside of a bundle is a batch of its own
+struct OscBatch {
+    vector<ofxOscMessage> messages;
+    uint64_t due;       // OscInput::now() time at which to apply, 0: immediately
+    uint64_t received;  // OscInput::now() time of arrival
+};
+
+// Receives OSC on a background thread. Unlike ofxOscReceiver, bundles
+// are kept together and their timetag is translated to a local time
+// at which they should be applied. Parsed batches are handed to the
+// render thread through a lock-free queue, stamped with their arrival
+// time.
+class OscInput : public osc::OscPacketListener {
+
+public:
+    OscInput();
+    ~OscInput();
+    bool setup(int port);
+    void stop();
+    bool next(OscBatch &batch);
+    size_t pending() const { return batches.size(); }
+    uint64_t dropped() const { return numDropped; }
+
+    // monotonic clock, in microseconds
+    static uint64_t now();
+    static uint64_t timetagToLocal(uint64_t timetag);
+    static uint64_t localToTimetag(uint64_t local);
+
+protected:
+    void ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint);
+    void ProcessBundle(const osc::ReceivedBundle &b, const IpEndpointName &remoteEndpoint);
+
+private:
+    void collect(const osc::ReceivedBundle &b, const IpEndpointName &remoteEndpoint,
+                 vector<ofxOscMessage> &messages);
+    ofxOscMessage convert(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint);
+    void push(OscBatch &&batch);
+
+    unique_ptr<UdpListeningReceiveSocket> socket;
+    std::thread listenThread;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> numDropped;
+    SpscQueue<OscBatch> batches;
+};
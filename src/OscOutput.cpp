@@ -0,0 +1,99 @@
+#include "OscOutput.h"
+
+#define WARN ofLogWarning("OscOutput")
+
+OscOutput::OscOutput() : buffer(65536), packets(1024) {
+    numDropped = 0;
+}
+
+OscOutput::~OscOutput() {
+    stop();
+}
+
+void OscOutput::setup(const string &host, int port) {
+    stop();
+    sender.setup(host, port);
+    socket.reset(new UdpTransmitSocket(IpEndpointName(host.c_str(), port)));
+    startThread();
+}
+
+void OscOutput::stop() {
+    if(isThreadRunning())
+        waitForThread(true);
+}
+
+void OscOutput::send(const ofxOscMessage &msg) {
+    Packet packet;
+    packet.bundle.addMessage(msg);
+    packet.isBundle = false;
+    packet.timetag = 0;
+    push(std::move(packet));
+}
+
+void OscOutput::send(const ofxOscBundle &bundle) {
+    push(Packet{bundle, true, 0});
+}
+
+void OscOutput::send(const ofxOscBundle &bundle, uint64_t timetag) {
+    push(Packet{bundle, true, timetag});
+}
+
+void OscOutput::push(Packet &&packet) {
+    if(!isThreadRunning())
+        return;
+    if(!packets.push(std::move(packet))) {
+        numDropped++;
+        WARN << "queue full, dropping packet";
+    }
+}
+
+void OscOutput::threadedFunction() {
+    // whatever was queued before stopping still goes out
+    Packet packet;
+    while(true) {
+        if(packets.pop(packet)) {
+            if(packet.timetag != 0)
+                sendTimed(packet);
+            else if(packet.isBundle)
+                sender.sendBundle(packet.bundle);
+            else
+                sender.sendMessage(packet.bundle.getMessageAt(0), false);
+        } else if(!isThreadRunning()) {
+            break;
+        } else {
+            // A frame is 16 ms or more, polling every ms keeps the added
+            // latency well below that
+            sleep(1);
+        }
+    }
+}
+
+void OscOutput::sendTimed(const Packet &packet) {
+    osc::OutboundPacketStream p(buffer.data(), buffer.size());
+    try {
+        p << osc::BeginBundle(packet.timetag);
+        for(size_t i=0; i<packet.bundle.getMessageCount(); i++) {
+            const auto &msg = packet.bundle.getMessageAt(i);
+            p << osc::BeginMessage(msg.getAddress().c_str());
+            for(size_t j=0; j<msg.getNumArgs(); j++) {
+                switch(msg.getArgType(j)) {
+                case OFXOSC_TYPE_INT32: p << msg.getArgAsInt32(j); break;
+                case OFXOSC_TYPE_INT64: p << static_cast<osc::int64>(msg.getArgAsInt64(j)); break;
+                case OFXOSC_TYPE_FLOAT: p << msg.getArgAsFloat(j); break;
+                case OFXOSC_TYPE_DOUBLE: p << msg.getArgAsDouble(j); break;
+                case OFXOSC_TYPE_STRING: p << msg.getArgAsString(j).c_str(); break;
+                case OFXOSC_TYPE_TRUE:
+                case OFXOSC_TYPE_FALSE: p << msg.getArgAsBool(j); break;
+                default:
+                    WARN << msg.getAddress() << ": skipping argument of unsupported type";
+                }
+            }
+            p << osc::EndMessage;
+        }
+        p << osc::EndBundle;
+        socket->Send(p.Data(), p.Size());
+    } catch(std::exception &e) {
+        numDropped++;
+        WARN << "could not send bundle: " << e.what();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "OscOutboundPacketStream.h"
+#include "SpscQueue.h"
+
+// Sends OSC on a background thread. The render thread only queues the
+// packets, so a slow or blocked socket never stalls a frame. Packets
+// which don't fit in the queue are dropped and counted. Must be fed from
+// a single thread
+class OscOutput : public ofThread {
+
+public:
+    OscOutput();
+    ~OscOutput();
+    void setup(const string &host, int port);
+    void stop();
+    void send(const ofxOscMessage &msg);
+    void send(const ofxOscBundle &bundle);
+    // a bundle to be applied at timetag (NTP time, see OscInput::localToTimetag)
+    void send(const ofxOscBundle &bundle, uint64_t timetag);
+    uint64_t dropped() const { return numDropped; }
+
+protected:
+    void threadedFunction();
+
+private:
+    struct Packet {
+        ofxOscBundle bundle;
+        bool isBundle;      // otherwise a single message, the only one in bundle
+        uint64_t timetag;   // 0: immediately
+    };
+    void push(Packet &&packet);
+    void sendTimed(const Packet &packet);
+
+    ofxOscSender sender;
+    // ofxOscSender can only send immediate bundles
+    unique_ptr<UdpTransmitSocket> socket;
+    vector<char> buffer;
+    SpscQueue<Packet> packets;
+    std::atomic<uint64_t> numDropped;
+};
@@ -0,0 +1,174 @@
+#include "OscTrace.h"
+
+#include <cerrno>
+
+#define ERR  ofLogError("OscTrace")
+
+static bool isNumber(const string &s, bool &isFloat) {
+    if(s.empty())
+        return false;
+    char *end = nullptr;
+    strtod(s.c_str(), &end);
+    isFloat = s.find_first_of(".eE") != string::npos;
+    return *end == '\0';
+}
+
+static vector<string> tokenize(const string &line) {
+    vector<string> tokens;
+    size_t i = 0;
+    while(i < line.size()) {
+        if(isspace(static_cast<unsigned char>(line[i]))) {
+            i++;
+        } else if(line[i] == '"') {
+            // the quote is kept to tell "1" (a string) from 1. \" and \\
+            // stand for " and \, see formatTraceLine
+            string tok = "\"";
+            i++;
+            while(i < line.size() && line[i] != '"') {
+                if(line[i] == '\\' && i + 1 < line.size() && (line[i+1] == '"' || line[i+1] == '\\'))
+                    i++;
+                tok += line[i++];
+            }
+            tokens.push_back(tok);
+            i++;
+        } else {
+            size_t end = i;
+            while(end < line.size() && !isspace(static_cast<unsigned char>(line[end])))
+                end++;
+            tokens.push_back(line.substr(i, end - i));
+            i = end;
+        }
+    }
+    return tokens;
+}
+
+bool readOscTrace(const string &path, vector<TraceEvent> &events) {
+    ifstream f(path);
+    if(!f) {
+        ERR << "could not open " << path;
+        return false;
+    }
+    string dir = ofFilePath::getEnclosingDirectory(ofFilePath::getAbsolutePath(path, false), false);
+    if(!dir.empty() && dir.back() == '/')
+        dir.pop_back();
+    events.clear();
+    string line;
+    size_t lineno = 0;
+    while(getline(f, line)) {
+        lineno++;
+        auto tokens = tokenize(line);
+        if(tokens.empty() || tokens[0][0] == '#')
+            continue;
+        bool isFloat;
+        if(tokens.size() < 2 || !isNumber(tokens[0], isFloat) || tokens[1][0] != '/') {
+            ERR << path << ":" << lineno << ": expected <secs> <address> [arg ...]";
+            return false;
+        }
+        double secs = strtod(tokens[0].c_str(), nullptr);
+        if(!isfinite(secs) || secs < 0 || secs > 1e9) {
+            ERR << path << ":" << lineno << ": time out of range: " << tokens[0];
+            return false;
+        }
+        TraceEvent ev;
+        ev.time = static_cast<uint64_t>(secs * 1000000.0);
+        ev.msg.setAddress(tokens[1]);
+        for(size_t i=2; i<tokens.size(); i++) {
+            const string &tok = tokens[i];
+            if(tok[0] == '"') {
+                string str = tok.substr(1);
+                ofStringReplace(str, "$TRACEDIR", dir);
+                ev.msg.addStringArg(str);
+            } else if(isNumber(tok, isFloat)) {
+                char *end = nullptr;
+                errno = 0;
+                if(isFloat) {
+                    float value = strtof(tok.c_str(), &end);
+                    if(errno == ERANGE) {
+                        ERR << path << ":" << lineno << ": float out of range: " << tok;
+                        return false;
+                    }
+                    ev.msg.addFloatArg(value);
+                } else {
+                    long long value = strtoll(tok.c_str(), &end, 10);
+                    if(*end != '\0' || errno == ERANGE) {
+                        ERR << path << ":" << lineno << ": int out of range: " << tok;
+                        return false;
+                    }
+                    if(value < INT32_MIN || value > INT32_MAX)
+                        ev.msg.addInt64Arg(value);
+                    else
+                        ev.msg.addIntArg(static_cast<int32_t>(value));
+                }
+            } else {
+                string str = tok;
+                ofStringReplace(str, "$TRACEDIR", dir);
+                ev.msg.addStringArg(str);
+            }
+        }
+        events.push_back(ev);
+    }
+    stable_sort(events.begin(), events.end(),
+                [](const TraceEvent &a, const TraceEvent &b) { return a.time < b.time; });
+    return true;
+}
+
+string formatTraceLine(uint64_t time, const ofxOscMessage &msg) {
+    stringstream line;
+    line << fixed << setprecision(6) << time / 1000000.0 << " " << msg.getAddress();
+    for(size_t i=0; i<msg.getNumArgs(); i++) {
+        switch(msg.getArgType(i)) {
+        case OFXOSC_TYPE_INT32:
+        case OFXOSC_TYPE_INT64:
+            line << " " << msg.getArgAsInt64(i);
+            break;
+        case OFXOSC_TYPE_FLOAT:
+        case OFXOSC_TYPE_DOUBLE:
+            // fixed: always with a '.', so that it is read back as a float
+            line << " " << msg.getArgAsDouble(i);
+            break;
+        default: {
+            // quotes and backslashes escaped, see tokenize
+            string str = msg.getArgAsString(i);
+            ofStringReplace(str, "\\", "\\\\");
+            ofStringReplace(str, "\"", "\\\"");
+            line << " \"" << str << "\"";
+        }
+        }
+    }
+    return line.str();
+}
+
+OscReplayer::~OscReplayer() {
+    stop();
+}
+
+bool OscReplayer::setup(const string &path, const string &host, int port) {
+    if(!readOscTrace(path, events))
+        return false;
+    sender.setup(host, port);
+    return true;
+}
+
+void OscReplayer::start() {
+    done = false;
+    startThread();
+}
+
+void OscReplayer::stop() {
+    if(isThreadRunning())
+        waitForThread(true);
+}
+
+void OscReplayer::threadedFunction() {
+    auto start = chrono::steady_clock::now();
+    for(const auto &ev: events) {
+        auto due = start + chrono::microseconds(ev.time);
+        // sleep in short steps so that stopThread is honoured
+        while(isThreadRunning() && chrono::steady_clock::now() < due)
+            this_thread::sleep_until(min(due, chrono::steady_clock::now() + chrono::milliseconds(50)));
+        if(!isThreadRunning())
+            break;
+        sender.sendMessage(ev.msg, false);
+    }
+    done = true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+
+// A recorded OSC session, one message per line:
+//
+//     <secs> <address> [arg ...]
+//
+// secs is the time since the start of the recording. Arguments without a
+// '.' are ints, numbers with one are floats and anything else a string
+// ("..." for strings with spaces, \" and \\ inside stand for " and \).
+// $TRACEDIR in a string is replaced by the folder of the trace when it
+// is read. Lines starting with # are comments
+struct TraceEvent {
+    uint64_t time;      // us since the start of the trace
+    ofxOscMessage msg;
+};
+
+bool readOscTrace(const string &path, vector<TraceEvent> &events);
+string formatTraceLine(uint64_t time, const ofxOscMessage &msg);
+
+// Sends the events of a trace to host:port on a background thread, each
+// at its original time relative to the start of the replay. Going through
+// UDP, the replayed messages take the same path as live ones
+class OscReplayer : public ofThread {
+
+public:
+    ~OscReplayer();
+    bool setup(const string &path, const string &host, int port);
+    void start();
+    void stop();
+    bool finished() const { return done; }
+    size_t size() const { return events.size(); }
+
+protected:
+    void threadedFunction();
+
+private:
+    vector<TraceEvent> events;
+    ofxOscSender sender;
+    std::atomic<bool> done{false};
+};
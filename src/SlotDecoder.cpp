@@ -0,0 +1,62 @@
+#include "SlotDecoder.h"
+
+// frames waiting to be presented. A few frames absorb a render thread
+// which is late by as much, without holding much memory at 4K
+static const size_t QUEUE_FRAMES = 3;
+
+SlotDecoder::SlotDecoder()
+    : mov(nullptr), duration(0), frames(QUEUE_FRAMES), spare(QUEUE_FRAMES + 1),
+      active(true), generation(0), numDropped(0) {
+}
+
+SlotDecoder::~SlotDecoder() {
+    stop();
+}
+
+void SlotDecoder::start(ofVideoPlayer &mov_, float duration_) {
+    mov = &mov_;
+    duration = duration_;
+    active = true;
+    startThread();
+}
+
+void SlotDecoder::stop() {
+    if(isThreadRunning())
+        waitForThread(true);
+}
+
+bool SlotDecoder::pop(DecodedFrame &frame) {
+    while(frames.pop(frame)) {
+        if(frame.generation == generation)
+            return true;
+        recycle(std::move(frame.pixels));
+    }
+    return false;
+}
+
+void SlotDecoder::recycle(ofPixels &&pixels) {
+    // dropped if the spare queue is full
+    spare.push(std::move(pixels));
+}
+
+void SlotDecoder::threadedFunction() {
+    while(isThreadRunning()) {
+        if(active) {
+            uint32_t gen = generation;
+            mov->update();
+            if(mov->isFrameNew()) {
+                DecodedFrame frame;
+                // copying into the memory of a presented frame, if any,
+                // saves an allocation per frame
+                spare.pop(frame.pixels);
+                frame.pixels = mov->getPixels();
+                frame.pts = mov->getPosition() * duration;
+                frame.generation = gen;
+                if(!frames.push(std::move(frame)))
+                    numDropped++;
+            }
+        }
+        // a frame is 16 ms or more at the rates we play
+        sleep(1);
+    }
+}
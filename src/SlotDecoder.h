@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SpscQueue.h"
+
+struct DecodedFrame {
+    ofPixels pixels;
+    float pts;              // clip secs
+    uint32_t generation;    // see SlotDecoder::flush
+};
+
+// Fetches the frames of one player on a thread of its own and queues them
+// with their timestamps for the render thread, see ofApp::presentFrame.
+// The player decodes on its backend's threads; what moves off the render
+// thread is waiting for, swapping and copying its frames. While this
+// runs, update(), isFrameNew() and getPixels() of the player must only
+// be called from here, and the player must not use a texture
+class SlotDecoder : public ofThread {
+
+public:
+    SlotDecoder();
+    ~SlotDecoder();
+    void start(ofVideoPlayer &mov_, float duration_);
+    void stop();
+    // inactive: frames are left in the player
+    void setActive(bool active_) { active = active_; }
+    // frames fetched so far are discarded, after a seek
+    void flush() { generation++; }
+    bool pop(DecodedFrame &frame);
+    // hands the memory of a presented frame back for reuse
+    void recycle(ofPixels &&pixels);
+    uint64_t dropped() const { return numDropped; }
+
+protected:
+    void threadedFunction();
+
+private:
+    ofVideoPlayer *mov;
+    float duration;
+    SpscQueue<DecodedFrame> frames;
+    SpscQueue<ofPixels> spare;
+    std::atomic<bool> active;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint64_t> numDropped;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one
+// consumer thread. push fails instead of blocking when the queue is full
+template<typename T>
+class SpscQueue {
+
+public:
+    explicit SpscQueue(size_t capacity)
+        : buffer(roundUp(capacity + 1)), mask(buffer.size() - 1), head(0), tail(0) {}
+
+    bool push(T &&item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) & mask;
+        if(next == head.load(std::memory_order_acquire))
+            return false;
+        buffer[t] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(buffer[h]);
+        head.store((h + 1) & mask, std::memory_order_release);
+        return true;
+    }
+
+    // only approximate while the other thread is active
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire);
+        return (t - h) & mask;
+    }
+
+private:
+    static size_t roundUp(size_t n) {
+        size_t p = 2;
+        while(p < n)
+            p <<= 1;
+        return p;
+    }
+
+    std::vector<T> buffer;
+    const size_t mask;
+    // padded onto separate cache lines, each is written by one thread only.
+    // (no alignas: over-aligned new needs c++17)
+    char pad0[64];
+    std::atomic<size_t> head;
+    char pad1[64];
+    std::atomic<size_t> tail;
+    char pad2[64];
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+// Keeps the most recent samples of a measurement (a latency or a
+// duration, in microseconds) to report its mean, max. and percentiles
+class Stats {
+
+public:
+    explicit Stats(size_t window_=1024) : window(window_), next(0), total(0) {}
+
+    void add(uint64_t sample) {
+        if(samples.size() < window)
+            samples.push_back(sample);
+        else
+            samples[next] = sample;
+        next = (next + 1) % window;
+        total++;
+    }
+
+    void reset() {
+        samples.clear();
+        next = 0;
+        total = 0;
+    }
+
+    uint64_t count() const { return total; }
+    bool empty() const { return samples.empty(); }
+
+    double mean() const {
+        if(samples.empty())
+            return 0;
+        double sum = 0;
+        for(auto s: samples)
+            sum += s;
+        return sum / samples.size();
+    }
+
+    uint64_t max() const {
+        return samples.empty() ? 0 : *std::max_element(samples.begin(), samples.end());
+    }
+
+    // p between 0 and 1
+    uint64_t percentile(double p) const {
+        if(samples.empty())
+            return 0;
+        std::vector<uint64_t> sorted(samples);
+        size_t idx = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+        return sorted[idx];
+    }
+
+private:
+    size_t window;
+    size_t next;
+    uint64_t total;
+    std::vector<uint64_t> samples;
+};
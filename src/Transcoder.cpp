@@ -0,0 +1,106 @@
+#include "Transcoder.h"
+#include "Util.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define LOG  ofLogVerbose("Transcoder")
+#define ERR  ofLogError("Transcoder")
+
+Transcoder::Transcoder() {
+    child = -1;
+}
+
+Transcoder::~Transcoder() {
+    stop();
+}
+
+string Transcoder::cachePath(const string &source, const string &cacheDir) const {
+    // cacheDir empty: the copy is put in .intracache next to the source
+    string dir = cacheDir.empty()
+            ? ofFilePath::join(ofFilePath::getEnclosingDirectory(source, false), ".intracache")
+            : cacheDir;
+    stringstream name;
+    name << ofFilePath::getBaseName(source) << "." << hex << contentHash(source) << ".intra.mkv";
+    return ofFilePath::join(dir, name.str());
+}
+
+void Transcoder::add(const TranscodeJob &job) {
+    if(!isThreadRunning())
+        startThread();
+    pending.send(job);
+}
+
+bool Transcoder::poll(TranscodeJob &job) {
+    return done.tryReceive(job);
+}
+
+void Transcoder::stop() {
+    pending.close();
+    done.close();
+    if(!isThreadRunning())
+        return;
+    // don't wait for a transcode which may take minutes: the worker reaps
+    // ffmpeg and removes its partial output
+    stopThread();
+    pid_t pid = child;
+    if(pid > 0)
+        kill(pid, SIGTERM);
+    waitForThread(true);
+}
+
+void Transcoder::threadedFunction() {
+    TranscodeJob job;
+    while(pending.receive(job)) {
+        // the same source loaded into several slots is transcoded once
+        if(ofFile::doesFileExist(job.target, false)) {
+            job.ok = true;
+            done.send(job);
+            continue;
+        }
+        ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(job.target, false), false, true);
+        // written under a temporary name so that a half finished copy is
+        // never picked up as a cache hit. The name is unique per process
+        // and slot, as other instances may share the cache directory
+        string part = job.target + "." + ofToString(getpid()) + "." + ofToString(job.slot) + ".part";
+        vector<string> args = {"ffmpeg", "-nostdin", "-y", "-v", "error", "-i", job.source,
+                               "-map", "0:v:0", "-map", "0:a?", "-c:v", "libx264", "-preset", "veryfast",
+                               "-crf", "16", "-g", "1", "-bf", "0", "-pix_fmt", "yuv420p", "-c:a", "copy",
+                               "-f", "matroska", part};
+        string cmd;
+        vector<char*> argv;
+        for(auto &arg: args) {
+            cmd += (cmd.empty() ? "" : " ") + shellQuote(arg);
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+        LOG << cmd;
+        uint64_t t0 = ofGetElapsedTimeMillis();
+        // run directly rather than through system(), so that stop() can
+        // kill it
+        int status = -1;
+        pid_t pid = fork();
+        if(pid == 0) {
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        if(pid > 0) {
+            child = pid;
+            // stop() may have come before child was set
+            if(!isThreadRunning())
+                kill(pid, SIGTERM);
+            waitpid(pid, &status, 0);
+            child = -1;
+        }
+        job.ok = status == 0 && ofFile::moveFromTo(part, job.target, false, true);
+        if(job.ok) {
+            LOG << "slot " << job.slot << ": " << job.source << " -> " << job.target
+                << " (" << ofGetElapsedTimeMillis() - t0 << " ms)";
+        } else {
+            ERR << "could not transcode " << job.source << " (status " << status << ")";
+            ofFile::removeFile(part, false);
+        }
+        done.send(job);
+    }
+}
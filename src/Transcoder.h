@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+struct TranscodeJob {
+    size_t slot;
+    string source;
+    string target;
+    bool batch;
+    bool ok;
+};
+
+// Converts clips to an intra-only copy (every frame a keyframe) on a
+// background thread, so that seeking in them never needs to decode a
+// whole GOP. Copies are cached on disk under a name derived from the
+// content of the source, later loads of the same clip reuse them.
+// Requires ffmpeg in the PATH
+class Transcoder : public ofThread {
+
+public:
+    Transcoder();
+    ~Transcoder();
+    string cachePath(const string &source, const string &cacheDir) const;
+    void add(const TranscodeJob &job);
+    bool poll(TranscodeJob &job);
+    void stop();
+
+protected:
+    void threadedFunction();
+
+private:
+    ofThreadChannel<TranscodeJob> pending;
+    ofThreadChannel<TranscodeJob> done;
+    std::atomic<pid_t> child;   // running ffmpeg, -1 if none
+};
@@ -0,0 +1,41 @@
+#include "Util.h"
+
+string shellQuote(const string &s) {
+    string out = "'";
+    for(char c: s) {
+        if(c == '\'')
+            out += "'\\''";
+        else
+            out += c;
+    }
+    return out + "'";
+}
+
+uint64_t fnv1a(const char *data, size_t n, uint64_t h) {
+    for(size_t i=0; i<n; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t contentHash(const string &path) {
+    // This identifies a clip independently of its name without reading
+    // it whole
+    const size_t chunk = 65536;
+    ifstream f(path, ios::binary);
+    f.seekg(0, ios::end);
+    uint64_t size = static_cast<uint64_t>(f.tellg());
+    uint64_t h = fnv1a(reinterpret_cast<const char*>(&size), sizeof(size));
+    vector<char> buf(chunk);
+    f.seekg(0);
+    f.read(buf.data(), chunk);
+    h = fnv1a(buf.data(), static_cast<size_t>(f.gcount()), h);
+    if(size > chunk) {
+        f.clear();
+        f.seekg(static_cast<streamoff>(size - chunk));
+        f.read(buf.data(), chunk);
+        h = fnv1a(buf.data(), static_cast<size_t>(f.gcount()), h);
+    }
+    return h;
+}
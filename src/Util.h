@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Helpers shared by the background workers which run ffmpeg and ffprobe
+// and name their cache files after a hash
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+// s quoted for /bin/sh
+string shellQuote(const string &s);
+// FNV-1a of n bytes, continuing from h
+uint64_t fnv1a(const char *data, size_t n, uint64_t h=FNV_OFFSET);
+// FNV-1a over the size and the first and last 64KB of a file
+uint64_t contentHash(const string &path);
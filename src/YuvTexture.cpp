@@ -0,0 +1,148 @@
+#include "YuvTexture.h"
+
+static const char *vertexSource = R"(
+#version 330
+uniform mat4 modelViewProjectionMatrix;
+in vec4 position;
+in vec2 texcoord;
+out vec2 texCoordVarying;
+void main() {
+    texCoordVarying = texcoord;
+    gl_Position = modelViewProjectionMatrix * position;
+}
+)";
+
+// limited range BT.601 (SD) or BT.709 (HD) to RGB
+static const char *fragmentSource = R"(
+#version 330
+uniform sampler2DRect planeY;
+uniform sampler2DRect planeU;       // U, or U and V interleaved
+uniform sampler2DRect planeV;
+uniform int interleaved;
+uniform int swapUV;
+uniform int bt709;
+uniform vec2 chromaScale;
+uniform vec4 tint;
+in vec2 texCoordVarying;
+out vec4 outputColor;
+void main() {
+    vec2 c = texCoordVarying * chromaScale;
+    float y = (texture(planeY, texCoordVarying).r - 0.0625) * 1.164;
+    vec2 uv = interleaved == 1 ? texture(planeU, c).rg
+                               : vec2(texture(planeU, c).r, texture(planeV, c).r);
+    if(swapUV == 1)
+        uv = uv.yx;
+    uv -= 0.5;
+    vec3 rgb = bt709 == 1
+        ? vec3(y + 1.793 * uv.y, y - 0.213 * uv.x - 0.533 * uv.y, y + 2.112 * uv.x)
+        : vec3(y + 1.596 * uv.y, y - 0.391 * uv.x - 0.813 * uv.y, y + 2.018 * uv.x);
+    outputColor = vec4(clamp(rgb, 0.0, 1.0), 1.0) * tint;
+}
+)";
+
+bool setupYuvShader(ofShader &shader) {
+    if(!ofIsGLProgrammableRenderer())
+        return false;
+    return shader.setupShaderFromSource(GL_VERTEX_SHADER, vertexSource) &&
+           shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragmentSource) &&
+           shader.bindDefaults() && shader.linkProgram();
+}
+
+static bool isPlanarYuv(ofPixelFormat format) {
+    return format == OF_PIXELS_I420 || format == OF_PIXELS_YV12 ||
+           format == OF_PIXELS_NV12 || format == OF_PIXELS_NV21;
+}
+
+YuvTexture::YuvTexture() {
+    shader = nullptr;
+    format = OF_PIXELS_UNKNOWN;
+    width = 0;
+    height = 0;
+    nextPbo = 0;
+}
+
+void YuvTexture::setup(const ofShader &shader_) {
+    shader = &shader_;
+}
+
+void YuvTexture::clear() {
+    planes.clear();
+    packed.clear();
+    format = OF_PIXELS_UNKNOWN;
+    width = 0;
+    height = 0;
+}
+
+bool YuvTexture::isAllocated() const {
+    if(isPlanarYuv(format))
+        return !planes.empty() && planes[0].tex.isAllocated();
+    return packed.isAllocated();
+}
+
+size_t YuvTexture::upload(ofPixels &pixels) {
+    format = pixels.getPixelFormat();
+    width = static_cast<int>(pixels.getWidth());
+    height = static_cast<int>(pixels.getHeight());
+    if(!isPlanarYuv(format) || shader == nullptr) {
+        planes.clear();
+        packed.loadData(pixels);
+        return pixels.getTotalBytes();
+    }
+    packed.clear();
+    size_t numPlanes = pixels.getNumPlanes();
+    if(planes.size() != numPlanes) {
+        planes.clear();
+        planes.resize(numPlanes);
+    }
+    size_t bytes = 0;
+    for(size_t i=0; i<numPlanes; i++) {
+        auto plane = pixels.getPlane(i);
+        auto &p = planes[i];
+        int w = static_cast<int>(plane.getWidth());
+        int h = static_cast<int>(plane.getHeight());
+        // a single channel, or the interleaved chroma of NV12
+        bool rg = plane.getNumChannels() == 2;
+        if(!p.tex.isAllocated() || p.tex.getWidth() != w || p.tex.getHeight() != h) {
+            p.tex.allocate(w, h, rg ? GL_RG8 : GL_R8);
+            p.tex.setTextureMinMagFilter(GL_LINEAR, GL_LINEAR);
+            p.glFormat = rg ? GL_RG : GL_RED;
+        }
+        // alternate between two buffers: the driver may still be reading
+        // the other one. setData orphans the old storage, so the copy
+        // never waits either
+        size_t size = plane.getTotalBytes();
+        auto &pbo = p.pbos[nextPbo];
+        if(!pbo.isAllocated())
+            pbo.allocate();
+        pbo.setData(size, plane.getData(), GL_STREAM_DRAW);
+        p.tex.loadData(pbo, p.glFormat, GL_UNSIGNED_BYTE);
+        bytes += size;
+    }
+    nextPbo = 1 - nextPbo;
+    return bytes;
+}
+
+void YuvTexture::draw(float x, float y, float w, float h) const {
+    if(!isPlanarYuv(format)) {
+        if(packed.isAllocated())
+            packed.draw(x, y, w, h);
+        return;
+    }
+    if(planes.size() < 2 || !planes[0].tex.isAllocated())
+        return;
+    const auto &luma = planes[0].tex;
+    const auto &chroma = planes[1].tex;
+    bool interleaved = planes.size() == 2;
+    shader->begin();
+    shader->setUniformTexture("planeY", luma, 0);
+    shader->setUniformTexture("planeU", chroma, 1);
+    shader->setUniformTexture("planeV", interleaved ? chroma : planes[2].tex, 2);
+    shader->setUniform1i("interleaved", interleaved);
+    shader->setUniform1i("swapUV", format == OF_PIXELS_YV12 || format == OF_PIXELS_NV21);
+    shader->setUniform1i("bt709", height >= 720);
+    shader->setUniform2f("chromaScale", chroma.getWidth() / luma.getWidth(),
+                         chroma.getHeight() / luma.getHeight());
+    shader->setUniform4f("tint", ofFloatColor(ofGetStyle().color));
+    luma.draw(x, y, w, h);
+    shader->end();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ofMain.h"
+
+// The frames of a player, uploaded as they come out of the decoder. The
+// planes of I420/YV12 and NV12/NV21 frames go to one texture each, through
+// a pair of pixel buffer objects so that the upload does not wait for the
+// transfer of the previous frame, and are converted to RGB by a shader
+// when drawn. Frames in other formats are uploaded as they are
+class YuvTexture : public ofBaseDraws {
+
+public:
+    YuvTexture();
+    void setup(const ofShader &shader_);
+    void clear();
+    // returns the number of bytes uploaded
+    size_t upload(ofPixels &pixels);
+    bool isAllocated() const;
+
+    using ofBaseDraws::draw;
+    void draw(float x, float y, float w, float h) const override;
+    float getWidth() const override { return static_cast<float>(width); }
+    float getHeight() const override { return static_cast<float>(height); }
+
+private:
+    struct Plane {
+        ofTexture tex;
+        ofBufferObject pbos[2];
+        int glFormat;
+    };
+    const ofShader *shader;
+    vector<Plane> planes;
+    ofTexture packed;           // frames which are not planar YUV
+    ofPixelFormat format;
+    int width;
+    int height;
+    size_t nextPbo;
+};
+
+// the shader drawing YuvTexture, needs the programmable renderer
+bool setupYuvShader(ofShader &shader);
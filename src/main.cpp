@@ -35,6 +35,40 @@ int main(int argc, char **argv){
     string outHost = "127.0.0.1";
     ui32 outPort = 0;
     int frameRate = 0;
+    int loadThreads = 4;
+    bool preroll = false;
+    int scrubCache = 0;
+    int scrubCacheMB = 256;
+    bool intra = false;
+    string cacheDir;
+    int maxOpen = 0;
+    int memBudget = 0;
+    bool coalesce = false;
+    int layers = 2;
+    bool headless = false;
+    string renderSize = "1280x720";
+    string renderOutput;
+    int renderFrames = 0;
+    string replayPath;
+    string recordPath;
+    bool bench = false;
+    float statsRate = 0;
+    float positionRate = 0;
+    float positionDelta = 0;
+    bool positionBundle = false;
+    bool masterClock = false;
+    string followers;
+    bool follow = false;
+    int syncLead = 50;
+    float stepBelow = 0.25f;
+    bool blend = false;
+    bool yuv = false;
+    bool decodeThreads = false;
+    bool clipIndex = false;
+    string indexDir;
+    float residentBelow = 0;
+    int residentMB = 1024;
+    bool watch = false;
 
     try {
         CmdLine cmd("OSC Video Player");
@@ -70,6 +104,183 @@ int main(int argc, char **argv){
 
         cmd.add(frameRateArg);
 
+        ValueArg<int> loadThreadsArg("", "load-threads",
+                                     "Number of clips opened concurrently when loading a folder",
+                                     false, 4, "int");
+        cmd.add(loadThreadsArg);
+
+        SwitchArg prerollSwitch("", "preroll",
+                                "Keep the start frame of each slot decoded as a texture, "
+                                "so that /play shows it on the next frame", false);
+        cmd.add(prerollSwitch);
+
+        ValueArg<int> scrubCacheArg("", "scrub-cache",
+                                    "Number of decoded frames kept around the playhead of a "
+                                    "scrubbed slot (0 disables the cache)", false, 0, "int");
+        cmd.add(scrubCacheArg);
+
+        ValueArg<int> scrubCacheMBArg("", "scrub-cache-mb",
+                                      "Max. memory per slot used by the scrub cache, in MB",
+                                      false, 256, "int");
+        cmd.add(scrubCacheMBArg);
+
+        SwitchArg intraSwitch("", "intra",
+                              "Load intra-only copies of the clips in --folder, transcoding "
+                              "them with ffmpeg when not cached yet", false);
+        cmd.add(intraSwitch);
+
+        ValueArg<string> cacheDirArg("", "cache-dir",
+                                     "Folder for intra-only copies (default: .intracache "
+                                     "next to each clip)", false, "", "string");
+        cmd.add(cacheDirArg);
+
+        ValueArg<int> maxOpenArg("", "max-open",
+                                 "Max. number of slots with an open decoder, the least "
+                                 "recently used are closed and reopened on demand (0: no limit)",
+                                 false, 0, "int");
+        cmd.add(maxOpenArg);
+
+        ValueArg<int> memBudgetArg("", "mem-budget",
+                                   "Max. estimated memory used by open slots, in MB (0: no limit)",
+                                   false, 0, "int");
+        cmd.add(memBudgetArg);
+
+        SwitchArg coalesceSwitch("", "coalesce",
+                                 "Of repeated /setspeed, /scrub, /scrubabs, /setpos and /settime "
+                                 "messages received within a frame, only apply the last one per slot",
+                                 false);
+        cmd.add(coalesceSwitch);
+
+        ValueArg<int> layersArg("", "layers",
+                                "Max. number of stacked slots drawn at once while the ones "
+                                "above are fading (1: hard cuts only)", false, 2, "int");
+        cmd.add(layersArg);
+
+        SwitchArg headlessSwitch("", "headless",
+                                 "Render offscreen with a software GL context, stepping a virtual "
+                                 "clock at --framerate (default 25) independently of wall time",
+                                 false);
+        cmd.add(headlessSwitch);
+
+        ValueArg<string> renderSizeArg("", "render-size",
+                                       "Size of the headless output, WxH", false, "1280x720",
+                                       "string");
+        cmd.add(renderSizeArg);
+
+        ValueArg<string> renderOutputArg("", "render-out",
+                                         "Write headless frames as raw rgb24 to this file or "
+                                         "named pipe, or to stdout if -", false, "", "string");
+        cmd.add(renderOutputArg);
+
+        ValueArg<int> renderFramesArg("", "render-frames",
+                                      "Quit after rendering this many headless frames (0: no limit)",
+                                      false, 0, "int");
+        cmd.add(renderFramesArg);
+
+        ValueArg<string> replayArg("", "replay",
+                                   "Send the OSC trace in this file to our own port, with its "
+                                   "original timing", false, "", "string");
+        cmd.add(replayArg);
+
+        ValueArg<string> recordArg("", "record-osc",
+                                   "Record incoming OSC to this file, as a trace for --replay",
+                                   false, "", "string");
+        cmd.add(recordArg);
+
+        SwitchArg benchSwitch("", "bench",
+                              "Report per frame timings, OSC latency and seek counts at exit. "
+                              "With --replay, quit when the trace is finished", false);
+        cmd.add(benchSwitch);
+
+        ValueArg<float> statsArg("", "stats",
+                                 "Send /stats telemetry this many times per sec to the oscout "
+                                 "address (0: off, see /stats)", false, 0, "float");
+        cmd.add(statsArg);
+
+        ValueArg<float> positionRateArg("", "position-rate",
+                                        "Max. number of /play position reports per sec sent to "
+                                        "the oscout address (0: every frame)", false, 0, "float");
+        cmd.add(positionRateArg);
+
+        ValueArg<float> positionDeltaArg("", "position-delta",
+                                         "Only report the position of a slot when it moved by more "
+                                         "than this, in secs", false, 0, "float");
+        cmd.add(positionDeltaArg);
+
+        SwitchArg positionBundleSwitch("", "position-bundle",
+                                       "Report the position of every visible slot, in one bundle "
+                                       "per report", false);
+        cmd.add(positionBundleSwitch);
+
+        SwitchArg masterClockSwitch("", "master-clock",
+                                    "Lock every played slot to the master clock sent via /clock",
+                                    false);
+        cmd.add(masterClockSwitch);
+
+        ValueArg<string> followersArg("", "followers",
+                                      "Lead the instances listening at these comma separated "
+                                      "[host:]ports: commands and slot positions are applied in "
+                                      "the same frame by all", false, "", "string");
+        cmd.add(followersArg);
+
+        SwitchArg followSwitch("", "follow",
+                               "Follow a leader (see --followers): lock slots to its clock",
+                               false);
+        cmd.add(followSwitch);
+
+        ValueArg<int> syncLeadArg("", "sync-lead",
+                                  "How far ahead a leader schedules commands, in ms", false, 50,
+                                  "int");
+        cmd.add(syncLeadArg);
+
+        ValueArg<float> stepBelowArg("", "step-below",
+                                     "Play speeds below this, and negative ones, by stepping "
+                                     "through decoded frames (0: only negative speeds)", false,
+                                     0.25f, "float");
+        cmd.add(stepBelowArg);
+
+        SwitchArg blendSwitch("", "blend",
+                              "Blend consecutive frames of slow and reverse playback", false);
+        cmd.add(blendSwitch);
+
+        SwitchArg yuvSwitch("", "yuv",
+                            "Upload decoded frames as planar YUV through pixel buffers and "
+                            "convert them to RGB in a shader", false);
+        cmd.add(yuvSwitch);
+
+        SwitchArg decodeThreadsSwitch("", "decode-threads",
+                                      "Fetch the frames of each slot on a thread of its own and "
+                                      "present them by timestamp (implies --yuv)", false);
+        cmd.add(decodeThreadsSwitch);
+
+        SwitchArg clipIndexSwitch("", "clip-index",
+                                  "Keep the metadata and keyframes of each clip in an index file, "
+                                  "built with ffprobe, so that later loads need not open the clip "
+                                  "first", false);
+        cmd.add(clipIndexSwitch);
+
+        ValueArg<string> indexDirArg("", "index-dir",
+                                     "Folder for clip index files (default: .clipindex next to "
+                                     "each clip)", false, "", "string");
+        cmd.add(indexDirArg);
+
+        ValueArg<float> residentBelowArg("", "resident-below",
+                                         "Keep every decoded frame of clips shorter than this "
+                                         "(secs) in memory, so that they play without the decoder "
+                                         "(0: only clips loaded with /load ... resident)",
+                                         false, 0, "float");
+        cmd.add(residentBelowArg);
+
+        ValueArg<int> residentMBArg("", "resident-mb",
+                                    "Max. memory used by the frames of all resident clips, in MB",
+                                    false, 1024, "int");
+        cmd.add(residentMBArg);
+
+        SwitchArg watchSwitch("", "watch",
+                              "Keep watching --folder and reload the slots of clips which are "
+                              "added, replaced or removed", false);
+        cmd.add(watchSwitch);
+
         cmd.parse(argc, argv);
         numslots = numslotsArg.getValue();
         port = portArg.getValue();
@@ -77,6 +288,40 @@ int main(int argc, char **argv){
         loadFolderPath = folder.getValue();
         printDocumentation = manSwitch.getValue();
         frameRate = frameRateArg.getValue();
+        loadThreads = loadThreadsArg.getValue();
+        preroll = prerollSwitch.getValue();
+        scrubCache = scrubCacheArg.getValue();
+        scrubCacheMB = scrubCacheMBArg.getValue();
+        intra = intraSwitch.getValue();
+        cacheDir = cacheDirArg.getValue();
+        maxOpen = maxOpenArg.getValue();
+        memBudget = memBudgetArg.getValue();
+        coalesce = coalesceSwitch.getValue();
+        layers = layersArg.getValue();
+        headless = headlessSwitch.getValue();
+        renderSize = renderSizeArg.getValue();
+        renderOutput = renderOutputArg.getValue();
+        renderFrames = renderFramesArg.getValue();
+        replayPath = replayArg.getValue();
+        recordPath = recordArg.getValue();
+        bench = benchSwitch.getValue();
+        statsRate = statsArg.getValue();
+        positionRate = positionRateArg.getValue();
+        positionDelta = positionDeltaArg.getValue();
+        positionBundle = positionBundleSwitch.getValue();
+        masterClock = masterClockSwitch.getValue();
+        followers = followersArg.getValue();
+        follow = followSwitch.getValue();
+        syncLead = syncLeadArg.getValue();
+        stepBelow = stepBelowArg.getValue();
+        blend = blendSwitch.getValue();
+        yuv = yuvSwitch.getValue();
+        decodeThreads = decodeThreadsSwitch.getValue();
+        clipIndex = clipIndexSwitch.getValue();
+        indexDir = indexDirArg.getValue();
+        residentBelow = residentBelowArg.getValue();
+        residentMB = residentMBArg.getValue();
+        watch = watchSwitch.getValue();
 
         if(debug) {
             ofSetLogLevel(OF_LOG_VERBOSE);
@@ -93,19 +338,50 @@ int main(int argc, char **argv){
         ofLogError("main") << e.error() << " for arg " << e.argId();
     }
 
+    // frames written to stdout: from here on, logs printed there go to
+    // stderr instead
+    if(headless && renderOutput == "-" && !FrameWriter::takeStdout())
+        return 1;
+
     ofLogNotice() << "debug: " << debug;
     ofLogNotice() << "numslots: " << numslots;
     ofLogNotice() << "OSC port: " << port;
     ofLogNotice() << "Out OSC: " << outHost << ":" << outPort;
 
+    int renderWidth = 1280, renderHeight = 720;
+    if(headless) {
+        if(sscanf(renderSize.c_str(), "%dx%d", &renderWidth, &renderHeight) != 2 ||
+           renderWidth <= 0 || renderHeight <= 0) {
+            ofLogError() << "--render-size should be WxH, got " << renderSize;
+            return 1;
+        }
+        if(frameRate <= 0)
+            frameRate = 25;
+        // mesa's software rasterizer, there is no GPU on a render node.
+        // Without a display, run under xvfb-run
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+    }
+
     // start
     ofGLFWWindowSettings settings;
     settings.setGLVersion(3,3);
+    if(headless) {
+        settings.setSize(renderWidth, renderHeight);
+        settings.visible = false;
+        settings.resizable = false;
+    }
     ofCreateWindow(settings);
     // ofSetupOpenGL(1024,768, OF_WINDOW);			// <-------- setup the GL context
     // ofSetVerticalSync(true);
-    if (frameRate > 0)
+    if(headless) {
+        // as fast as frames can be rendered, time advances by a fixed
+        // step per frame
+        ofSetVerticalSync(false);
+        ofSetFrameRate(0);
+        ofSetTimeModeFixedRate(ofGetFixedStepForFps(frameRate));
+    } else if (frameRate > 0) {
         ofSetFrameRate(frameRate);
+    }
     // this kicks off the running of my app
     // can be OF_WINDOW or OF_FULLSCREEN
     // pass in width and height too:
@@ -116,9 +392,52 @@ int main(int argc, char **argv){
         app->oscOutPort = outPort;
 
     }
+    app->maxLoads = loadThreads > 0 ? (size_t)loadThreads : 1;
+    app->usePreroll = preroll;
+    app->scrubCacheFrames = scrubCache > 0 ? (size_t)scrubCache : 0;
+    app->scrubCacheMB = scrubCacheMB > 0 ? (size_t)scrubCacheMB : 0;
+    app->intraOnLoad = intra;
+    app->intraCacheDir = cacheDir;
+    app->maxOpen = maxOpen > 0 ? (size_t)maxOpen : 0;
+    app->memBudgetMB = memBudget > 0 ? (size_t)memBudget : 0;
+    app->coalesceOsc = coalesce;
+    app->numLayers = layers > 0 ? (size_t)layers : 1;
+    app->headless = headless;
+    app->renderFps = frameRate;
+    app->renderOutput = renderOutput;
+    app->maxRenderFrames = renderFrames > 0 ? (uint64_t)renderFrames : 0;
+    app->replayPath = replayPath;
+    app->recordPath = recordPath;
+    app->benchmark = bench;
+    app->positionRate = positionRate > 0 ? positionRate : 0;
+    app->positionDelta = positionDelta > 0 ? positionDelta : 0;
+    app->positionBundle = positionBundle;
+    app->followClock = masterClock || follow || !followers.empty();
+    app->syncLead = syncLead > 0 ? (uint64_t)syncLead * 1000 : 0;
+    app->stepBelow = stepBelow > 0 ? stepBelow : 0;
+    app->blendFrames = blend;
+    app->yuvUpload = yuv;
+    app->decodeThreads = decodeThreads;
+    app->useClipIndex = clipIndex;
+    app->clipIndexDir = indexDir;
+    // before the --folder load below, which looks clips up in the index
+    app->clipIndex.setup(indexDir);
+    app->residentBelow = residentBelow > 0 ? residentBelow : 0;
+    app->residentMB = residentMB > 0 ? (size_t)residentMB : 0;
+    for(const auto &addr: ofSplitString(followers, ",", true, true)) {
+        string host;
+        ui32 port;
+        parseOscAddress(addr, host, port);
+        if(port != 0)
+            app->addFollower(host, port);
+    }
+    if(statsRate > 0 && outPort == 0)
+        ofLogError() << "--stats needs an --oscout address";
+    else
+        app->statsRate = statsRate > 0 ? statsRate : 0;
 
     if(!loadFolderPath.empty()) {
-        int ok = app->loadFolder(loadFolderPath);
+        int ok = app->loadFolder(loadFolderPath, watch);
         if(!ok) {
             cerr << "*ERROR* Could not load some clips from folder " << loadFolderPath << endl;
         }
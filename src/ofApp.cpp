@@ -1,6 +1,8 @@
 
 #include "ofApp.h"
 
+#include <unistd.h>
+
 #define LOG  ofLogVerbose()
 #define INFO ofLogNotice()
 #define ERR  ofLogError()
@@ -17,6 +19,58 @@ ofApp::ofApp(size_t numslots_, int port_) {
     debugging = true;
     draw_x0 = 0;
     draw_y0 = 0;
+    registerOscCommands();
+    coalesceOsc = false;
+    numLayers = 2;
+    numCoalesced = 0;
+    loadTimeout = 10000;
+    usePreroll = false;
+    scrubCacheFrames = 0;
+    scrubCacheMB = 256;
+    intraOnLoad = false;
+    useClipIndex = false;
+    residentBelow = 0;
+    residentMB = 1024;
+    watchSettle = 500;
+    maxOpen = 0;
+    memBudgetMB = 0;
+    maxLoads = 4;
+    headless = false;
+    renderFps = 25;
+    maxRenderFrames = 0;
+    renderedFrames = 0;
+    benchmark = false;
+    numSeeks = 0;
+    yuvUpload = false;
+    uploadedBytes = 0;
+    decodeThreads = false;
+    numSkippedFrames = 0;
+    parkAfter = 1000000;
+    numDroppedFrames = 0;
+    lastUpdateStart = 0;
+    replayDoneAt = 0;
+    recordStart = 0;
+    benchStart = 0;
+    statsRate = 0;
+    positionRate = 0;
+    positionDelta = 0;
+    positionBundle = false;
+    lastPositionAt = 0;
+    lastPositionSlot = numSlots;
+    followClock = false;
+    batchTime = 0;
+    syncLead = 50000;
+    stepBelow = 0.25f;
+    stepCacheFrames = 32;
+    loopLeadFrames = 8;
+    blendFrames = false;
+    leaderStart = 0;
+    statsWindow = StatsWindow{0, 0, 0, 0, 0, 0, 0, 0, 0};
+    // enough for a few minutes of frames, a benchmark reports all of them
+    updateTimes = Stats(65536);
+    drawTimes = Stats(65536);
+    frameIntervals = Stats(65536);
+    loadBatch = LoadBatch{"", 0, 0, 0, 0, 0, 0};
 
     for (int i=0; i < numSlots; i++) {
         loaded.push_back(0);
@@ -25,8 +79,59 @@ ofApp::ofApp(size_t numslots_, int port_) {
         paused.push_back(0);
         shouldStop.push_back(0);
         durations.push_back(0.f);
+        paths.push_back("");
+        numFrames.push_back(0);
+        widths.push_back(0);
+        heights.push_back(0);
+        isOpen.push_back(false);
+        lastUsed.push_back(0);
         drawclip.push_back(false);
         needsUpdate.push_back(false);
+        prerolls.push_back(ofFbo());
+        prerollTimes.push_back(0.f);
+        showPreroll.push_back(false);
+        cues.push_back(CueList());
+        cuePaths.push_back("");
+        yuvTextures.push_back(YuvTexture());
+        frameNew.push_back(false);
+        decoders.push_back(nullptr);
+        presentQueues.push_back(deque<DecodedFrame>());
+        hiddenSince.push_back(0);
+        parkedTimes.push_back(-1.f);
+        parkedAt.push_back(0);
+        bridgeFrames.push_back(-1);
+        bridgeReady.push_back(false);
+        opacities.push_back(1.f);
+        fadeTargets.push_back(1.f);
+        fadeRates.push_back(0.f);
+        fadeStops.push_back(false);
+        scrubCaches.push_back(FrameCache());
+        scrubFrames.push_back(-1);
+        decodeTargets.push_back(-1);
+        playheads.push_back(0.f);
+        clockFrames.push_back(-1);
+        statsFrames.push_back(-1);
+        newFrameAt.push_back(0);
+        slotDuplicated.push_back(0);
+        reportedTimes.push_back(-1.f);
+        synced.push_back(false);
+        syncOffsets.push_back(0);
+        syncErrors.push_back(0.f);
+        syncFactors.push_back(1.f);
+        syncSeekAt.push_back(0);
+        syncSpeedAt.push_back(0);
+        stepping.push_back(false);
+        stepFrames.push_back(-1);
+        steppedAt.push_back(0);
+        shownFrames.push_back(-1);
+        transcoding.push_back("");
+        clipInfos.push_back(ClipInfo());
+        runEnds.push_back(-1);
+        wantResident.push_back(false);
+        resident.push_back(false);
+        residentFull.push_back(false);
+        seekTargets.push_back(-1);
+        frameTimes.push_back(0.f);
     }
 }
 
@@ -34,49 +139,94 @@ void ofApp::setup(){
     // numSlots = NUMSLOTS;
     draw_height = ofGetWindowHeight();
     draw_width = ofGetWindowWidth();
-    oscReceiver.setup(oscPort);
+    if(!oscInput.setup(oscPort)) {
+        ERR << "Could not listen to OSC port " << oscPort << endl;
+    }
     if(oscOutPort != 0) {
-        oscSender.setup(oscOutHost, oscOutPort);
+        oscOutput.setup(oscOutHost, oscOutPort);
     }
     ofBackground(0);
+    if(decodeThreads && headless) {
+        // the virtual clock waits for each frame itself
+        LOG << "headless: --decode-threads ignored";
+        decodeThreads = false;
+    }
+    // the workers leave uploading to the render thread
+    if(decodeThreads)
+        yuvUpload = true;
+    if(yuvUpload) {
+        if(setupYuvShader(yuvShader)) {
+            for(auto &tex: yuvTextures)
+                tex.setup(yuvShader);
+        } else {
+            ERR << "--yuv: could not set up the YUV shader, players upload their frames" << endl;
+            yuvUpload = false;
+            decodeThreads = false;
+        }
+    }
+    if(headless) {
+        int w = ofGetWindowWidth();
+        int h = ofGetWindowHeight();
+        renderFbo.allocate(w, h, GL_RGB);
+        if(!renderOutput.empty()) {
+            if(!frameWriter.open(renderOutput)) {
+                ERR << "headless: could not open output " << renderOutput << endl;
+                ofExit(1);
+                return;
+            }
+            INFO << "headless: writing rgb24 " << w << "x" << h << " @ " << renderFps
+                 << " fps to " << renderOutput << endl;
+        }
+    }
+    benchStart = OscInput::now();
+    leaderStart = benchStart;
+    if(!recordPath.empty()) {
+        oscRecord.open(recordPath);
+        if(!oscRecord)
+            ERR << "Could not open " << recordPath << " to record OSC" << endl;
+        oscRecord << "# OSC trace recorded by OSC-Video-Player, <secs> <address> [arg ...]\n";
+        recordStart = OscInput::now();
+    }
+    if(!replayPath.empty()) {
+        if(replayer.setup(replayPath, "127.0.0.1", oscPort)) {
+            INFO << "Replaying " << replayer.size() << " messages from " << replayPath << endl;
+            replayer.start();
+        } else {
+            ERR << "Could not read OSC trace " << replayPath << endl;
+            replayPath.clear();
+        }
+    }
     printOscApi();
     printKeyboardShortcuts();
 }
 
+void ofApp::exit() {
+    replayer.stop();
+    for(size_t slot=0; slot<numSlots; slot++)
+        stopDecoder(slot);
+    if(benchmark)
+        reportBenchmark();
+    oscRecord.close();
+    frameWriter.close();
+    oscOutput.stop();
+    for(auto &follower: followers)
+        follower->stop();
+    oscInput.stop();
+    transcoder.stop();
+    clipIndex.stop();
+}
+
 void ofApp::printOscApi() {
     cout << "OSC port: " << oscPort << "\n";
     cout << "Number of Slots: " << numSlots << "\n\n";
-    cout << "OSC messages accepted:\n\n"
-            "/load slot:int path:str\n"
-            "    * Load a video at the given slot \n\n"
-            "/play slot:int [speed:float=1] [starttime:float=0] [paused:int=0] [stopWhenFinished:int=1]\n"
-            "    * Play the given slot with given speed, starting at starttime (secs)\n\n"
-            "      paused: if 1, the playback will be paused\n"
-            "      stopWhenFinished: if 1, playback will stop at the end, otherwise it\n"
-            "        pauses at the last frame\n\n"
-            "/stop [slot:int] \n"
-            "    * Stop playback. If no slot is given, the currently playing slot is stopped\n\n"
-            "/pause state:int\n"
-            "    * If state 1, pause playback, 0 resumes playback\n\n"
-            "/setspeed speed:float \n"
-            "    * Change the speed of the playing slot\n\n"
-            "/scrub pos:float [slot:int=current] \n"
-            "    * Set the relative position 0-1. Sets the given slot as the current slot\n"
-            "      In scrub mode, video is paused and must be driven externally\n\n"
-            "/scrubabs timepos:float [slot:int=current] \n"
-            "    * Set the absolute time and activates the given slot. In scrub mode, video\n"
-            "      is paused and must be driven externally\n\n"
-            "/setpos \n"
-            "     * Sets the relative (0-1) playing position of the current clip\n"
-            "       (does not pause the clip like /scrub)\n\n"
-            "/settime \n"
-            "     * Sets the absolute playing position of the current clip\n"
-            "       (does not pause the clip like /scrubabs)\n\n"
-            "/dump \n"
-            "    * Dump information about loaded clips\n\n"
-            "/quit \n"
-            "    * Quit this application\n"
-            ;
+    cout << "OSC messages accepted:\n\n";
+    for(const auto &address: oscCommandOrder) {
+        const auto &cmd = oscCommands[address];
+        cout << cmd.usage << "\n" << cmd.doc << "\n";
+    }
+    cout << "Messages sent together in a bundle are applied in the same frame. If the\n"
+            "bundle has a timetag in the future, they are applied in the frame closest\n"
+            "to that time\n";
 }
 
 void ofApp::printKeyboardShortcuts() {
@@ -90,38 +240,1080 @@ void ofApp::printKeyboardShortcuts() {
 
 
 //--------------------------------------------------------------
-bool ofApp::loadMov(int slot, const string &path) {
-    if(slot < 0 && slot >= numSlots) {
+bool ofApp::loadMov(int slot, const string &path, bool batch, bool intra, bool ram,
+                    const string &source) {
+    if(slot < 0 || slot >= numSlots) {
         ERR << "loadMov -- Slot out of range: " << slot << endl;
         return false;
     }
     auto idx = static_cast<size_t>(slot);
-    if(loaded[idx] == 1) {
+    if(!ofFile::doesFileExist(path)) {
+        ERR << "loadMov -- File not found: " << path << endl;
+        sendLoaded(idx, false);
+        return false;
+    }
+    // a newer request for the same slot supersedes one still in flight
+    cancelLoad(idx);
+    wantResident[idx] = ram;
+    pendingUnloads.erase(remove(pendingUnloads.begin(), pendingUnloads.end(), idx),
+                         pendingUnloads.end());
+    string loadPath = path;
+    string cuePath = cueFilePath(source.empty() ? path : source);
+    if(intra) {
+        string cached = transcoder.cachePath(path, intraCacheDir);
+        if(ofFile::doesFileExist(cached)) {
+            LOG << "loadMov -- Using intra-only copy " << cached;
+            loadPath = cached;
+        } else {
+            INFO << "loadMov -- Transcoding slot " << idx << " to intra-only: " << path << endl;
+            transcoding[idx] = path;
+            transcoder.add(TranscodeJob{idx, path, cached, batch, false});
+            return true;
+        }
+    }
+    // a slot on screen keeps its player until the new one is ready
+    if(useClipIndex && !drawclip[idx] && clipIndex.lookup(loadPath, clipInfos[idx])) {
+        // indexed before: the slot is usable right away, as a closed slot
+        // which is opened in the background or on first use
+        const auto &info = clipInfos[idx];
+        LOG << "loadMov -- Metadata of slot " << idx << " from index: " << loadPath;
+        uint64_t started = ofGetElapsedTimeMillis();
+        stopDecoder(idx);
+        if(loaded[idx] && isOpen[idx])
+            movs[idx].close();
+        isOpen[idx] = false;
+        lastUsed[idx] = ofGetFrameNum();
+        durations[idx] = info.duration;
+        numFrames[idx] = info.numFrames;
+        widths[idx] = info.width;
+        heights[idx] = info.height;
+        registerClip(idx, loadPath, cuePath, started);
+        if(batch)
+            finishBatchItem(idx, loadPath, started, true);
+        // resident slots need their player to fill the frame store
+        if((maxOpen == 0 && memBudgetMB == 0) || resident[idx])
+            reopenMov(idx);
+        return true;
+    }
+    loadJobs.emplace_back();
+    auto &job = loadJobs.back();
+    job.slot = idx;
+    job.path = loadPath;
+    job.running = false;
+    job.batch = batch;
+    job.reopen = false;
+    job.cuePath = cuePath;
+    job.started = 0;
+    LOG << "loadMov -- Queued slot " << idx << ": " << path;
+    return true;
+}
+
+void ofApp::cancelLoad(size_t idx) {
+    // drop the load or transcode of idx still in flight, if any, and the
+    // commands waiting for it
+    for(auto it = loadJobs.begin(); it != loadJobs.end(); ++it) {
+        if(it->slot == idx) {
+            LOG << "loadMov -- Cancelling pending load for slot " << idx << ": " << it->path;
+            if(it->running)
+                it->mov.close();
+            if(it->batch)
+                finishBatchItem(it->slot, it->path, it->started, false);
+            loadJobs.erase(it);
+            break;
+        }
+    }
+    transcoding[idx].clear();
+    deferred.erase(remove_if(deferred.begin(), deferred.end(),
+                             [idx](const pair<size_t, ofxOscMessage> &d) { return d.first == idx; }),
+                   deferred.end());
+}
+
+void ofApp::unloadSlot(size_t slot) {
+    cancelLoad(slot);
+    stopDecoder(slot);
+    if(isOpen[slot])
+        movs[slot].close();
+    prerollQueue.erase(remove(prerollQueue.begin(), prerollQueue.end(), slot), prerollQueue.end());
+    isOpen[slot] = false;
+    loaded[slot] = 0;
+    paths[slot] = "";
+    durations[slot] = 0;
+    numFrames[slot] = 0;
+    clipInfos[slot] = ClipInfo();
+    cues[slot].clear();
+    cuePaths[slot] = "";
+    resident[slot] = false;
+    residentFull[slot] = false;
+    scrubCaches[slot].setup(0);
+    prerolls[slot].clear();
+    yuvTextures[slot].clear();
+    INFO << "Unloaded slot " << slot << endl;
+    if(oscOutPort != 0) {
+        ofxOscMessage msg;
+        msg.setAddress("/unloaded");
+        msg.addIntArg(slot);
+        oscOutput.send(msg);
+    }
+}
+
+bool ofApp::ensureOpen(size_t slot) {
+    // Marks slot as used. Returns true if its player is open, otherwise
+    // starts reopening it and returns false
+    lastUsed[slot] = ofGetFrameNum();
+    if(isOpen[slot])
+        return true;
+    reopenMov(slot);
+    return false;
+}
+
+void ofApp::reopenMov(size_t slot) {
+    for(const auto &job: loadJobs) {
+        if(job.slot == slot)
+            return;
+    }
+    LOG << "reopening slot " << slot << ": " << paths[slot];
+    // goes before any queued folder loads
+    loadJobs.emplace_front();
+    auto &job = loadJobs.front();
+    job.slot = slot;
+    job.path = paths[slot];
+    job.running = false;
+    job.batch = false;
+    job.reopen = true;
+    job.started = 0;
+}
+
+size_t ofApp::slotMemory(size_t slot) {
+    // Rough estimate of what an open player costs: the decoder keeps
+    // around 8 frames in yuv420 (12 bytes/pixel), plus the textures
+    return static_cast<size_t>(widths[slot]) * heights[slot] * 16;
+}
+
+void ofApp::evictSlots() {
+    // Close the least recently used players until the number of open
+    // slots and their estimated memory are within budget. Slots in the
+    // stack or with commands waiting for them are never closed
+    if(maxOpen == 0 && memBudgetMB == 0)
+        return;
+    size_t numOpen = 0;
+    size_t mem = 0;
+    for(size_t i=0; i<numSlots; i++) {
+        if(isOpen[i]) {
+            numOpen++;
+            mem += slotMemory(i);
+        }
+    }
+    size_t budget = memBudgetMB * 1024 * 1024;
+    while((maxOpen > 0 && numOpen > maxOpen) || (budget > 0 && mem > budget)) {
+        size_t victim = numSlots;
+        for(size_t i=0; i<numSlots; i++) {
+            if(!isOpen[i] || resident[i] || find(stack.begin(), stack.end(), i) != stack.end())
+                continue;
+            bool waiting = any_of(deferred.begin(), deferred.end(),
+                                  [i](const pair<size_t, ofxOscMessage> &d) { return d.first == i; });
+            if(waiting)
+                continue;
+            if(victim == numSlots || lastUsed[i] < lastUsed[victim])
+                victim = i;
+        }
+        if(victim == numSlots)
+            break;
+        LOG << "closing least recently used slot " << victim;
+        stopDecoder(victim);
+        movs[victim].close();
+        isOpen[victim] = false;
+        numOpen--;
+        mem -= slotMemory(victim);
+    }
+}
+
+void ofApp::updateLoads() {
+    // Poll the clips being loaded in the background. A clip is ready once
+    // the player reports it as loaded and knows its duration. At most
+    // maxLoads clips are opened at the same time, the rest wait in order
+    TranscodeJob transcoded;
+    while(transcoder.poll(transcoded)) {
+        auto idx = transcoded.slot;
+        if(transcoding[idx] != transcoded.source) {
+            LOG << "loadMov -- Discarding superseded transcode for slot " << idx;
+            if(transcoded.batch)
+                finishBatchItem(idx, transcoded.source, 0, false);
+            continue;
+        }
+        transcoding[idx].clear();
+        if(!transcoded.ok)
+            WARN << "loadMov -- Transcoding failed, loading original clip: " << transcoded.source;
+        string path = transcoded.ok ? transcoded.target : transcoded.source;
+        if(!loadMov(static_cast<int>(idx), path, transcoded.batch, false, wantResident[idx],
+                    transcoded.source) && transcoded.batch)
+            finishBatchItem(idx, path, 0, false);
+    }
+
+    IndexJob indexed;
+    while(clipIndex.poll(indexed)) {
+        // the slot may have been loaded with another clip meanwhile
+        auto idx = indexed.slot;
+        if(!indexed.ok || !loaded[idx] || paths[idx] != indexed.clip ||
+           !clipIndex.lookup(indexed.clip, clipInfos[idx]))
+            continue;
+        // frames are counted from the table from now on: frames cached
+        // under the estimated numbering are dropped
+        numFrames[idx] = clipInfos[idx].numFrames;
+        scrubCaches[idx].setup(resident[idx] ? numFrames[idx] : scrubCaches[idx].capacity());
+        residentFull[idx] = false;
+        decodeTargets[idx] = -1;
+    }
+
+    uint64_t now = ofGetElapsedTimeMillis();
+    size_t running = 0;
+    auto it = loadJobs.begin();
+    while(it != loadJobs.end()) {
+        auto &job = *it;
+        if(!job.running) {
+            if(running >= maxLoads) {
+                ++it;
+                continue;
+            }
+            job.running = true;
+            job.started = now;
+            // mov.setPixelFormat(OF_PIXELS_RGB);
+            job.mov.setPixelFormat(OF_PIXELS_NATIVE);
+            // with yuvUpload the frames are uploaded by updatePlayer
+            job.mov.setUseTexture(!yuvUpload);
+            // the backend opens and prerolls the clip on its own threads.
+            // Backends without async support fall back to a blocking load
+            job.mov.loadAsync(job.path);
+        }
+        job.mov.update();
+        if(job.mov.isLoaded() && job.mov.getDuration() > 0.001f && job.mov.getWidth() > 0) {
+            finishLoad(job);
+            it = loadJobs.erase(it);
+        } else if(now - job.started > loadTimeout) {
+            ERR << "loadMov -- Timed out loading slot " << job.slot << ": " << job.path << endl;
+            job.mov.close();
+            if(job.reopen) {
+                auto idx = job.slot;
+                deferred.erase(remove_if(deferred.begin(), deferred.end(),
+                                         [idx](const pair<size_t, ofxOscMessage> &d) { return d.first == idx; }),
+                               deferred.end());
+            } else {
+                sendLoaded(job.slot, false);
+            }
+            if(job.batch)
+                finishBatchItem(job.slot, job.path, job.started, false);
+            it = loadJobs.erase(it);
+        } else {
+            running++;
+            ++it;
+        }
+    }
+}
+
+void ofApp::finishLoad(LoadJob &job) {
+    auto idx = job.slot;
+    // A clip replaced while on screen goes on from the time the old one
+    // was at. Its last frame is shown until the new player has decoded
+    // the first one, so that the swap does not show as a stall
+    bool onScreen = !job.reopen && loaded[idx] && isOpen[idx] && drawclip[idx];
+    ofFbo lastFrame;
+    float lastTime = 0;
+    bool wasPaused = false;
+    int scrubbedAt = scrubFrames[idx];
+    if(onScreen) {
+        copyFrame(idx, lastFrame);
+        lastTime = slotTime(idx);
+        wasPaused = stepping[idx] ? paused[idx] : movs[idx].isPaused();
+    }
+    stopDecoder(idx);
+    if(loaded[idx] == 1 && isOpen[idx]) {
         LOG << "Slot already loaded. Closing old movie, idx: " << idx;
         movs[idx].close();
     }
+    movs[idx] = std::move(job.mov);
     auto & mov = movs[idx];
-    // mov.setPixelFormat(OF_PIXELS_RGB);
-    mov.setPixelFormat(OF_PIXELS_NATIVE);
-    mov.load(path);
     mov.setLoopState(OF_LOOP_NONE);
     mov.setPaused(true);
     mov.play();
+    isOpen[idx] = true;
+    lastUsed[idx] = ofGetFrameNum();
+
+    if(job.reopen) {
+        // same clip as before: the metadata, preroll and scrub cache are
+        // still valid. Run the commands which were waiting for this slot
+        LOG << "Reopened slot " << idx << " (" << ofGetElapsedTimeMillis() - job.started << " ms)";
+        // positions are relative to the duration the backend reports
+        durations[idx] = mov.getDuration();
+        startDecoder(idx);
+        if(usePreroll)
+            parkAtPreroll(idx);
+        vector<ofxOscMessage> msgs;
+        auto it = deferred.begin();
+        while(it != deferred.end()) {
+            if(it->first == idx) {
+                msgs.push_back(it->second);
+                it = deferred.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for(const auto &msg: msgs)
+            handleOscMessage(msg);
+        evictSlots();
+        return;
+    }
+
+    durations[idx] = mov.getDuration();
+    numFrames[idx] = mov.getTotalNumFrames();
+    widths[idx] = static_cast<int>(mov.getWidth());
+    heights[idx] = static_cast<int>(mov.getHeight());
+    if(useClipIndex) {
+        clipInfos[idx] = ClipInfo();
+        clipIndex.add(idx, job.path);
+    }
+    registerClip(idx, job.path, job.cuePath, job.started);
+    startDecoder(idx);
+    if(onScreen) {
+        // stopMov parks the slot at its preroll again, which replaces the
+        // frame kept here
+        prerolls[idx] = std::move(lastFrame);
+        showPreroll[idx] = true;
+        float time = ofClamp(lastTime, 0.f, durations[idx]);
+        playheads[idx] = time;
+        if(scrubbedAt >= 0) {
+            scrubTo(idx, frameAtTime(idx, time));
+        } else {
+            seekFrame(idx, frameAtTime(idx, time));
+            paused[idx] = wasPaused;
+            mov.setPaused(wasPaused);
+            applySpeed(idx);
+        }
+    } else if(usePreroll) {
+        parkAtPreroll(idx);
+    }
+    if(job.batch)
+        finishBatchItem(job.slot, job.path, job.started, true);
+    evictSlots();
+}
 
+void ofApp::registerClip(size_t idx, const string &path, const string &cuePath, uint64_t started) {
+    // the part of loading a new clip which does not need its player:
+    // durations, numFrames, widths and heights are already set
     loaded[idx] = 1;
-    float dur = mov.getDuration();
-    if(dur < 0.001) {
-        ERR << "loadMov -- Clip too short: " << path << ", dur: " << dur << endl;
-        return false;
+    paths[idx] = path;
+    showPreroll[idx] = false;
+    prerolls[idx].clear();
+    bridgeFrames[idx] = -1;
+    yuvTextures[idx].clear();
+    cuePaths[idx] = cuePath;
+    if(cues[idx].load(cuePath))
+        LOG << "cues -- slot " << idx << ": " << cues[idx].points.size() << " from " << cuePath;
+    scrubFrames[idx] = -1;
+    decodeTargets[idx] = -1;
+    runEnds[idx] = -1;
+    seekTargets[idx] = -1;
+    stepping[idx] = false;
+    setupFrameCache(idx, scrubCacheFrames);
+    resident[idx] = false;
+    residentFull[idx] = false;
+    if(!headless && (wantResident[idx] || (residentBelow > 0 && durations[idx] < residentBelow)))
+        makeResident(idx);
+    if(cues[idx].loopIn != 0 || cues[idx].loopOut != 0)
+        setLoop(idx, cues[idx].loopIn, cues[idx].loopOut);
+    INFO << "Loaded slot " << idx << ": " << path
+         << " (" << ofGetElapsedTimeMillis() - started << " ms)" << endl;
+    if(idx == currentSlot()) {
+        calculateDrawCoords();
     }
-    durations[idx] = dur;
-    INFO << "Loaded slot " << slot << ": " << path << endl;
+    sendLoaded(idx, true);
     if(this->oscOutPort != 0) {
         this->sendClipInfo(idx, this->oscOutHost, this->oscOutPort);
     }
+}
+
+size_t ofApp::residentBytes(size_t slot) {
+    // what the frame store of a resident slot takes, see FrameCache::memory
+    return static_cast<size_t>(numFrames[slot]) * widths[slot] * heights[slot] * 3;
+}
+
+bool ofApp::makeResident(size_t slot) {
+    // Reserve a frame store for every frame of slot, if all resident slots
+    // together stay within residentMB. Otherwise the slot plays from its
+    // decoder as usual
+    size_t used = 0;
+    for(size_t i=0; i<numSlots; i++) {
+        if(resident[i] && i != slot)
+            used += residentBytes(i);
+    }
+    size_t need = residentBytes(slot);
+    size_t cap = residentMB * 1024 * 1024;
+    if(need == 0 || used + need > cap) {
+        WARN << "resident -- slot " << slot << " needs " << need / (1024 * 1024) << " MB, "
+             << (cap - min(used, cap)) / (1024 * 1024) << " MB left: playing it from the decoder";
+        return false;
+    }
+    resident[slot] = true;
+    residentFull[slot] = false;
+    scrubCaches[slot].setup(static_cast<size_t>(numFrames[slot]));
+    LOG << "resident -- slot " << slot << ": " << numFrames[slot] << " frames, "
+        << need / (1024 * 1024) << " MB";
+    return true;
+}
+
+void ofApp::fillFrameStores() {
+    // Decode ahead into the frame stores of slots which are not on screen,
+    // for up to 4 ms per frame in total: every frame of a resident slot,
+    // the first frames of the loop of a looping one (see wrapLoop). A
+    // resident slot on screen plays from its decoder until its store is
+    // complete, from then on it is always stepped (see applySpeed) and its
+    // player stays paused
+    const uint64_t budget = 4000;
+    uint64_t start = OscInput::now();
+    for(size_t slot=0; slot<numSlots; slot++) {
+        if(!isOpen[slot] || drawclip[slot] || residentFull[slot])
+            continue;
+        int from, to;
+        if(resident[slot]) {
+            from = 0;
+            to = numFrames[slot] - 1;
+        } else if(cues[slot].looping() && loopLead(slot) > 0) {
+            from = frameAtTime(slot, cues[slot].loopIn);
+            to = from + loopLead(slot) - 1;
+        } else {
+            continue;
+        }
+        if(find(prerollQueue.begin(), prerollQueue.end(), slot) != prerollQueue.end())
+            continue;
+        auto &mov = movs[slot];
+        auto &cache = scrubCaches[slot];
+        bool stored = false;
+        while(OscInput::now() - start < budget) {
+            updatePlayer(slot);
+            if(decodeTargets[slot] >= 0) {
+                if(!frameNew[slot])
+                    break;
+                cache.store(decodeTargets[slot], player(slot), from);
+                decodeTargets[slot] = -1;
+                stored = true;
+            }
+            int missing = cache.firstMissing(from, to);
+            if(missing < 0 && resident[slot]) {
+                residentFull[slot] = true;
+                INFO << "resident -- slot " << slot << ": " << numFrames[slot] << " frames, "
+                     << cache.memory() / (1024 * 1024) << " MB" << endl;
+                break;
+            }
+            if(missing < 0) {
+                if(stored) {
+                    LOG << "loop -- slot " << slot << ": " << to - from + 1 << " frames kept";
+                    // back to the warm-start frame the player was moved away from
+                    if(usePreroll)
+                        parkAtPreroll(slot);
+                }
+                break;
+            }
+            if(missing == currentFrame(slot) + 1)
+                mov.nextFrame();
+            else
+                seekFrame(slot, missing);
+            decodeTargets[slot] = missing;
+        }
+    }
+}
+
+void ofApp::finishBatchItem(size_t slot, const string &path, uint64_t started, bool ok) {
+    auto &b = loadBatch;
+    if(b.pending == 0)
+        return;
+    uint64_t now = ofGetElapsedTimeMillis();
+    if(ok) {
+        uint64_t t = now - started;
+        b.loaded++;
+        b.clipTime += t;
+        b.maxClipTime = max(b.maxClipTime, t);
+    } else {
+        b.failed++;
+        ERR << "/loadfolder: failed to load slot " << slot << ": " << path << endl;
+    }
+    b.pending--;
+    if(b.pending == 0)
+        reportBatch();
+}
+
+void ofApp::reportBatch() {
+    // summary of a folder ingest, once none of its clips is pending
+    const auto &b = loadBatch;
+    float total = (ofGetElapsedTimeMillis() - b.started) / 1000.f;
+    float avg = b.loaded > 0 ? (float)b.clipTime / b.loaded : 0.f;
+    INFO << "/loadfolder " << b.path << " finished in " << total << " s" << endl
+         << "    loaded: " << b.loaded << ", failed: " << b.failed << endl
+         << "    time per clip: " << avg << " ms avg., " << b.maxClipTime << " ms max." << endl;
+    if(oscOutPort != 0) {
+        ofxOscMessage msg;
+        msg.setAddress("/loadfolder");
+        msg.addStringArg(b.path);
+        msg.addIntArg(b.loaded);
+        msg.addIntArg(b.failed);
+        msg.addFloatArg(total);
+        oscOutput.send(msg);
+    }
+}
+
+void ofApp::sendLoaded(size_t slot, bool ok) {
+    if(oscOutPort == 0)
+        return;
+    ofxOscMessage msg;
+    msg.setAddress("/loaded");
+    msg.addIntArg(slot);
+    msg.addIntArg(ok ? 1 : 0);
+    oscOutput.send(msg);
+}
+
+void ofApp::sendSeeked(size_t slot, int frame) {
+    // where a seek asked for over OSC landed: the frame and its timestamp
+    if(oscOutPort == 0)
+        return;
+    ofxOscMessage msg;
+    msg.setAddress("/seeked");
+    msg.addIntArg(slot);
+    msg.addIntArg(frame);
+    msg.addFloatArg(timeAtFrame(slot, frame));
+    oscOutput.send(msg);
+}
+
+int ofApp::frameAtTime(size_t slot, float time) {
+    // indexed clips map time through their frame table, which is exact for
+    // variable frame rates and streams not starting at 0
+    if(clipInfos[slot].valid())
+        return clipInfos[slot].frameAt(time);
+    int totalFrames = numFrames[slot];
+    int frame = static_cast<int>((time/durations[slot]) * totalFrames);
+    if(frame >= totalFrames)
+        frame = totalFrames - 1;
+    return frame < 0 ? 0 : frame;
+}
+
+float ofApp::timeAtFrame(size_t slot, int frame) {
+    // start of frame, secs
+    if(clipInfos[slot].valid())
+        return static_cast<float>(clipInfos[slot].frameTime(frame));
+    return numFrames[slot] > 0 ? frame * durations[slot] / numFrames[slot] : 0.f;
+}
+
+int ofApp::currentFrame(size_t slot) {
+    // the backend derives frame numbers from the position assuming a
+    // constant frame rate
+    if(clipInfos[slot].valid())
+        return frameAtTime(slot, movs[slot].getPosition() * durations[slot]);
+    return movs[slot].getCurrentFrame();
+}
+
+void ofApp::seekFrame(size_t slot, int frame) {
+    auto &mov = movs[slot];
+    const auto &info = clipInfos[slot];
+    runEnds[slot] = -1;
+    endBridge(slot);
+    if(!info.valid()) {
+        mov.setFrame(frame);
+    } else if(mov.isPaused() && frame == currentFrame(slot) + 1 && info.keyframeBefore(frame) < frame) {
+        // the next frame of the same GOP: a step decodes just that one,
+        // a seek would decode again from the keyframe
+        mov.nextFrame();
+        return;
+    } else {
+        // an accurate seek to the start of the frame: the backend decodes
+        // from the keyframe before it up to there
+        mov.setPosition(timeAtFrame(slot, frame) / durations[slot]);
+    }
+    if(decoders[slot]) {
+        decoders[slot]->flush();
+        for(auto &queued: presentQueues[slot])
+            decoders[slot]->recycle(std::move(queued.pixels));
+        presentQueues[slot].clear();
+    }
+    numSeeks++;
+    resetSlotStats(slot);
+}
+
+void ofApp::parkAtPreroll(size_t slot) {
+    // Leave the (paused) player at its warm-start frame and keep a copy of
+    // that frame as a texture. A /play starting there is then a texture
+    // swap: the copy is drawn until the player delivers its next frame
+    auto &mov = movs[slot];
+    int frame = frameAtTime(slot, prerollTimes[slot]);
+    if(currentFrame(slot) != frame)
+        seekFrame(slot, frame);
+    if(find(prerollQueue.begin(), prerollQueue.end(), slot) == prerollQueue.end())
+        prerollQueue.push_back(slot);
+}
+
+void ofApp::updatePrerolls() {
+    auto it = prerollQueue.begin();
+    while(it != prerollQueue.end()) {
+        size_t slot = *it;
+        auto &mov = movs[slot];
+        if(!loaded[slot] || !isOpen[slot] || drawclip[slot]) {
+            // unloaded, closed or started playing before the frame arrived
+            it = prerollQueue.erase(it);
+            continue;
+        }
+        updatePlayer(slot);
+        bool hasFrame = yuvUpload ? yuvTextures[slot].isAllocated() : mov.getTexture().isAllocated();
+        if(!hasFrame ||
+           currentFrame(slot) != frameAtTime(slot, prerollTimes[slot])) {
+            ++it;
+            continue;
+        }
+        copyFrame(slot, prerolls[slot]);
+        LOG << "preroll -- slot " << slot << " parked at " << prerollTimes[slot] << " s";
+        it = prerollQueue.erase(it);
+    }
+}
+
+void ofApp::copyFrame(size_t slot, ofFbo &fbo) {
+    // keep the current frame of the player of slot as a texture
+    const auto &src = player(slot);
+    int w = static_cast<int>(src.getWidth());
+    int h = static_cast<int>(src.getHeight());
+    if(!fbo.isAllocated() || fbo.getWidth() != w || fbo.getHeight() != h)
+        fbo.allocate(w, h, GL_RGB);
+    fbo.begin();
+    ofClear(0, 0, 0, 255);
+    src.draw(0, 0, w, h);
+    fbo.end();
+}
+
+void ofApp::updatePlayer(size_t slot) {
+    // With yuvUpload the player keeps its frames in memory, in the format
+    // of the decoder, and they are uploaded here: the planes of YUV frames
+    // as they are, converted to RGB when drawn
+    auto &mov = movs[slot];
+    frameNew[slot] = false;
+    if(decoders[slot]) {
+        presentFrame(slot);
+    } else {
+        mov.update();
+        if(!mov.isFrameNew())
+            return;
+        frameNew[slot] = true;
+        frameTimes[slot] = mov.getPosition() * durations[slot];
+        size_t bytes;
+        if(yuvUpload)
+            bytes = yuvTextures[slot].upload(mov.getPixels());
+        else
+            bytes = mov.getPixels().getTotalBytes();
+        uploadedBytes += bytes;
+        statsWindow.uploaded += bytes;
+    }
+    if(frameNew[slot] && seekTargets[slot] >= 0) {
+        sendSeeked(slot, frameAtTime(slot, frameTimes[slot]));
+        seekTargets[slot] = -1;
+    }
+}
+
+void ofApp::presentFrame(size_t slot) {
+    // Frames fetched by the worker of slot wait in presentQueues until
+    // they are due: the last one with a timestamp before the next vsync is
+    // uploaded, older ones are skipped. Stepped, scrubbed and paused slots
+    // take every frame in order, each was asked for
+    auto &queue = presentQueues[slot];
+    auto &decoder = *decoders[slot];
+    DecodedFrame frame;
+    while(decoder.pop(frame))
+        queue.push_back(std::move(frame));
+    if(queue.empty())
+        return;
+    auto &mov = movs[slot];
+    size_t pick = 0;
+    if(!stepping[slot] && scrubFrames[slot] < 0 && !mov.isPaused() && speeds[slot] > 0) {
+        float due = mov.getPosition() * durations[slot] + speeds[slot] * frameTime();
+        size_t numDue = 0;
+        while(numDue < queue.size() && queue[numDue].pts <= due)
+            numDue++;
+        if(numDue == 0)
+            return;
+        pick = numDue - 1;
+    }
+    for(size_t i=0; i<pick; i++) {
+        decoder.recycle(std::move(queue.front().pixels));
+        queue.pop_front();
+        numSkippedFrames++;
+    }
+    size_t bytes = yuvTextures[slot].upload(queue.front().pixels);
+    frameTimes[slot] = queue.front().pts;
+    decoder.recycle(std::move(queue.front().pixels));
+    queue.pop_front();
+    frameNew[slot] = true;
+    uploadedBytes += bytes;
+    statsWindow.uploaded += bytes;
+}
+
+void ofApp::startDecoder(size_t slot) {
+    if(!decodeThreads)
+        return;
+    presentQueues[slot].clear();
+    decoders[slot].reset(new SlotDecoder());
+    decoders[slot]->start(movs[slot], durations[slot]);
+}
+
+void ofApp::stopDecoder(size_t slot) {
+    // before the player is closed or replaced
+    decoders[slot].reset();
+    presentQueues[slot].clear();
+}
+
+size_t ofApp::firstVisible() {
+    // Index in the stack of the lowest slot which is drawn. Lower slots
+    // are only drawn while the ones above are not opaque (fading), at
+    // most numLayers in total
+    size_t top = stack.size() - 1;
+    size_t first = top;
+    while(first > 0 && top - first + 1 < numLayers &&
+          !(drawclip[stack[first]] && opacities[stack[first]] >= 1.f)) {
+        first--;
+    }
+    return first;
+}
+
+void ofApp::updateVisibility(uint64_t now) {
+    // Slots in the stack under the visible ones are not drawn: their
+    // frames are neither fetched nor uploaded, and after parkAfter they
+    // are paused, to be resumed where they would be by then once they are
+    // uncovered. Slots which need their player to keep time (synced,
+    // looping, stepped) are never parked
+    if(stack.empty())
+        return;
+    size_t first = firstVisible();
+    for(size_t i=0; i<stack.size(); i++) {
+        size_t slot = stack[i];
+        bool hidden = i < first && drawclip[slot];
+        if(decoders[slot])
+            decoders[slot]->setActive(!hidden);
+        if(!hidden) {
+            hiddenSince[slot] = 0;
+            if(parkedTimes[slot] >= 0)
+                unpark(slot, now);
+            continue;
+        }
+        if(hiddenSince[slot] == 0) {
+            hiddenSince[slot] = now;
+            continue;
+        }
+        auto &mov = movs[slot];
+        bool parkable = !headless && !paused[slot] && !mov.isPaused() && !stepping[slot] &&
+                        scrubFrames[slot] < 0 && !synced[slot] && !cues[slot].looping();
+        if(parkedTimes[slot] < 0 && parkable && now - hiddenSince[slot] > parkAfter) {
+            parkedTimes[slot] = slotTime(slot);
+            parkedAt[slot] = now;
+            mov.setPaused(true);
+            LOG << "slot " << slot << " hidden, parked at " << parkedTimes[slot] << " s";
+        }
+    }
+}
+
+void ofApp::unpark(size_t slot, uint64_t now) {
+    float time = parkedTimes[slot] + speeds[slot] * (now - parkedAt[slot]) / 1000000.f;
+    parkedTimes[slot] = -1;
+    if(time >= durations[slot]) {
+        // it would have finished meanwhile
+        seekFrame(slot, numFrames[slot] - 1);
+        if(shouldStop[slot])
+            drawclip[slot] = false;
+        return;
+    }
+    seekFrame(slot, frameAtTime(slot, time));
+    movs[slot].setPaused(false);
+}
+
+const ofBaseDraws &ofApp::player(size_t slot) {
+    // what draws the current frame of slot
+    if(yuvUpload)
+        return yuvTextures[slot];
+    return movs[slot];
+}
+
+void ofApp::setLoop(size_t slot, float in, float out) {
+    // out <= in ends the loop, playback goes on to the end of the clip.
+    // Used for the loop of a .cues sidecar as well
+    auto &c = cues[slot];
+    endBridge(slot);
+    if(out < in)
+        WARN << "loop -- slot " << slot << ": out " << out << " before in " << in << ", not looping";
+    c.loopIn = ofClamp(in, 0.f, durations[slot]);
+    c.loopOut = ofClamp(out, 0.f, durations[slot]);
+    if(c.loopOut <= c.loopIn)
+        c.loopIn = c.loopOut = 0;
+    setupLoopLead(slot);
+    INFO << "loop -- slot " << slot << ": " << c.loopIn << " - " << c.loopOut << endl;
+}
+
+void ofApp::updateLoop(size_t slot) {
+    // called after the player of a looping slot has been updated. The
+    // first frames of the loop are kept in the frame cache, ahead of time
+    // (see fillFrameStores) or as playback passes them. At the wrap they
+    // are drawn like those of a stepped slot while the player seeks past
+    // them, and the player resumes once the playhead reaches the frame it
+    // has been sent to
+    auto &mov = movs[slot];
+    const auto &c = cues[slot];
+    int inFrame = frameAtTime(slot, c.loopIn);
+    int outFrame = c.loopOut >= durations[slot] ? numFrames[slot] : frameAtTime(slot, c.loopOut);
+    if(bridgeFrames[slot] >= 0) {
+        int end = bridgeFrames[slot];
+        if(frameNew[slot])
+            bridgeReady[slot] = true;
+        if(!paused[slot])
+            playheads[slot] += speeds[slot] * frameTime();
+        // hold the last cached frame while the seek has not landed yet
+        if(!bridgeReady[slot])
+            playheads[slot] = min(playheads[slot], timeAtFrame(slot, end));
+        stepFrames[slot] = frameAtTime(slot, playheads[slot]);
+        if(bridgeReady[slot] && stepFrames[slot] >= end) {
+            bridgeFrames[slot] = -1;
+            mov.setPaused(paused[slot]);
+        }
+        return;
+    }
+    if(frameNew[slot]) {
+        int frame = frameAtTime(slot, frameTimes[slot]);
+        auto &cache = scrubCaches[slot];
+        if(frame >= inFrame && frame < inFrame + loopLead(slot) && !cache.has(frame))
+            cache.store(frame, player(slot), inFrame);
+    }
+    if(!paused[slot] && (mov.getIsMovieDone() || currentFrame(slot) >= outFrame))
+        wrapLoop(slot);
+}
+
+void ofApp::wrapLoop(size_t slot) {
+    // The player seeks to the first frame of the loop which is not in the
+    // frame cache. Until it gets there, the cached ones are drawn (see
+    // updateLoop). Without any cached, it seeks to the loop start and
+    // stalls for as long as the seek takes
+    auto &mov = movs[slot];
+    float in = cues[slot].loopIn;
+    int frame = frameAtTime(slot, in);
+    int lead = 0;
+    int maxLead = loopLead(slot);
+    while(lead < maxLead && scrubCaches[slot].has(frame + lead))
+        lead++;
+    if(lead > 0) {
+        mov.setPaused(true);
+        seekFrame(slot, frame + lead);
+        bridgeFrames[slot] = frame + lead;
+        bridgeReady[slot] = false;
+        playheads[slot] = in;
+        stepFrames[slot] = frame;
+        shownFrames[slot] = -1;
+    } else {
+        seekFrame(slot, frame);
+        if(mov.isPaused())
+            mov.setPaused(false);
+    }
+    // synced slots stay locked, from the loop start on
+    anchorSync(slot, in);
+}
+
+void ofApp::endBridge(size_t slot) {
+    // leave the wrap of a loop before the player has caught up: it plays
+    // on from where it is
+    if(bridgeFrames[slot] < 0)
+        return;
+    bridgeFrames[slot] = -1;
+    if(!stepping[slot] && scrubFrames[slot] < 0)
+        movs[slot].setPaused(paused[slot]);
+}
+
+int ofApp::loopLead(size_t slot) {
+    // frames at the start of the loop of slot which are kept decoded,
+    // fewer if the loop or the frame cache is shorter
+    const auto &c = cues[slot];
+    int inFrame = frameAtTime(slot, c.loopIn);
+    int outFrame = c.loopOut >= durations[slot] ? numFrames[slot] : frameAtTime(slot, c.loopOut);
+    int lead = min(static_cast<int>(loopLeadFrames), static_cast<int>(scrubCaches[slot].capacity()));
+    return max(0, min(lead, outFrame - inFrame - 1));
+}
+
+void ofApp::setupLoopLead(size_t slot) {
+    // make room in the frame cache of a looping slot for its loop lead
+    if(headless || resident[slot] || !cues[slot].looping())
+        return;
+    if(scrubCaches[slot].capacity() < loopLeadFrames)
+        setupFrameCache(slot, loopLeadFrames);
+}
+
+bool ofApp::loopPlayhead(size_t slot) {
+    // wrap the playhead of a stepped or headless slot at the loop region,
+    // in either direction. Returns true if it wrapped
+    const auto &c = cues[slot];
+    if(!c.looping())
+        return false;
+    float len = c.loopOut - c.loopIn;
+    float &t = playheads[slot];
+    if(speeds[slot] >= 0 && t >= c.loopOut)
+        t = c.loopIn + fmod(t - c.loopIn, len);
+    else if(speeds[slot] < 0 && t < c.loopIn)
+        t = c.loopOut - fmod(c.loopIn - t, len);
+    else
+        return false;
+    anchorSync(slot, t);
     return true;
 }
 
+void ofApp::setupFrameCache(size_t slot, size_t frames) {
+    // frames: 0 disables the cache. Limited to scrubCacheMB per slot
+    if(frames == 0) {
+        scrubCaches[slot].setup(0);
+        return;
+    }
+    size_t frameBytes = static_cast<size_t>(widths[slot]) * heights[slot] * 3;
+    size_t cap = min(frames, scrubCacheMB * 1024 * 1024 / max(frameBytes, (size_t)1));
+    scrubCaches[slot].setup(cap);
+    LOG << "frame cache -- slot " << slot << ": " << cap << " frames";
+}
+
+void ofApp::scrubTo(size_t slot, int frame) {
+    // Frames already in the scrub cache are drawn from there, the player
+    // is only asked to seek when the frame has not been decoded yet
+    scrubFrames[slot] = frame;
+    stepping[slot] = false;
+    bridgeFrames[slot] = -1;
+    auto &cache = scrubCaches[slot];
+    if(cache.enabled() && cache.has(frame)) {
+        sendSeeked(slot, frame);
+        return;
+    }
+    if(currentFrame(slot) != frame || !cache.enabled()) {
+        seekFrame(slot, frame);
+        seekTargets[slot] = frame;
+    } else {
+        sendSeeked(slot, frame);
+    }
+    decodeTargets[slot] = frame;
+}
+
+void ofApp::updateScrubCache(size_t slot) {
+    // called after the player of a scrubbed or stepped slot has been updated
+    auto &cache = scrubCaches[slot];
+    auto &mov = movs[slot];
+    // playing backwards, the window lies behind the playhead
+    bool reverse = stepping[slot] && speeds[slot] < 0;
+    int playhead = stepping[slot] ? stepFrames[slot] : scrubFrames[slot];
+    int half = static_cast<int>(cache.capacity() / 2);
+    if(decodeTargets[slot] >= 0) {
+        if(!frameNew[slot])
+            return;
+        cache.store(decodeTargets[slot], player(slot), reverse ? playhead - half : playhead);
+        decodeTargets[slot] = -1;
+    }
+    // idle: decode one more frame of the window around the playhead.
+    // Frames following the one just decoded are reached without a seek.
+    // Backwards, the part of the GOP before the playhead is decoded
+    // forwards, nearest half first
+    int missing;
+    int current = currentFrame(slot);
+    if(runEnds[slot] > current) {
+        // on the way from a keyframe to the frame that was missing
+        missing = current + 1;
+    } else if(reverse) {
+        missing = cache.firstMissing(playhead - half, playhead);
+        if(missing < 0)
+            missing = cache.firstMissing(playhead - 2 * half + 1, playhead - half - 1);
+    } else {
+        missing = cache.missingAround(playhead, numFrames[slot]);
+    }
+    if(missing < 0)
+        return;
+    if(missing == current + 1) {
+        mov.nextFrame();
+    } else {
+        // Seeking to a frame decodes its whole GOP up to it anyway. With
+        // the keyframes known, the seek goes to the keyframe and the frames
+        // up to the missing one are kept on the way, if they are within
+        // the window
+        int key = clipInfos[slot].keyframeBefore(missing);
+        int windowStart = reverse ? playhead - 2 * half + 1 : playhead - half;
+        if(key >= windowStart && key < missing) {
+            seekFrame(slot, key);
+            runEnds[slot] = missing;
+            missing = key;
+        } else {
+            seekFrame(slot, missing);
+        }
+    }
+    decodeTargets[slot] = missing;
+}
+
+void ofApp::applySpeed(size_t slot) {
+    // The backend only plays forwards at reasonable speeds. Slower and
+    // negative speeds are played by stepping: the player stays paused,
+    // playheads[slot] advances at the requested speed and the frames
+    // around it are decoded ahead into the frame cache, which is what
+    // is drawn
+    auto &mov = movs[slot];
+    float speed = speeds[slot];
+    // resident slots are always stepped, through their frame store
+    bool step = !headless && (residentFull[slot] || speed < 0 || fabs(speed) < stepBelow);
+    if(step && !stepping[slot]) {
+        LOG << "slot " << slot << ": stepping at speed " << speed;
+        stepping[slot] = true;
+        scrubFrames[slot] = -1;
+        stepFrames[slot] = frameAtTime(slot, playheads[slot]);
+        shownFrames[slot] = -1;
+        decodeTargets[slot] = -1;
+        bridgeFrames[slot] = -1;
+        mov.setPaused(true);
+        // a looping slot may only have room for its loop lead
+        auto &cache = scrubCaches[slot];
+        if(!cache.enabled() || (!resident[slot] && scrubCacheFrames == 0 && cache.capacity() < stepCacheFrames))
+            setupFrameCache(slot, stepCacheFrames);
+    } else if(!step && stepping[slot]) {
+        stepping[slot] = false;
+        decodeTargets[slot] = -1;
+        seekFrame(slot, frameAtTime(slot, playheads[slot]));
+        mov.setPaused(paused[slot]);
+    }
+    if(!step && !headless && mov.getSpeed() != speed * syncFactors[slot])
+        mov.setSpeed(speed * syncFactors[slot]);
+}
+
+void ofApp::stepSlot(size_t slot, uint64_t now) {
+    if(steppedAt[slot] == now)
+        return;
+    steppedAt[slot] = now;
+    auto &mov = movs[slot];
+    float dur = durations[slot];
+    // synced slots were already set to the master clock by updateSync
+    bool following = synced[slot] && masterClock.valid(now);
+    if(!paused[slot] && !following)
+        playheads[slot] += speeds[slot] * frameTime();
+    if(!loopPlayhead(slot) && (playheads[slot] >= dur || playheads[slot] < 0)) {
+        // reached either end: pause there, like a player does
+        playheads[slot] = ofClamp(playheads[slot], 0.f, dur);
+        paused[slot] = true;
+        if(shouldStop[slot])
+            drawclip[slot] = false;
+    }
+    stepFrames[slot] = frameAtTime(slot, playheads[slot]);
+    // fast reverse needs more than one decoded frame per vsync: keep
+    // taking frames while the player has one ready, for up to 4 ms, and
+    // leave the rest to the next frame rather than wait for the decoder
+    const uint64_t budget = 4000;
+    while(true) {
+        updatePlayer(slot);
+        int pending = decodeTargets[slot];
+        updateScrubCache(slot);
+        bool stored = pending >= 0 && decodeTargets[slot] != pending;
+        if(!stored || decodeTargets[slot] < 0 || OscInput::now() - now > budget)
+            break;
+    }
+}
+
+float ofApp::slotTime(size_t slot) {
+    // current position of slot, secs
+    if(headless || stepping[slot] || bridgeFrames[slot] >= 0)
+        return playheads[slot];
+    return movs[slot].getPosition() * durations[slot];
+}
+
 bool ofApp::playClip(size_t slot, float speed, float skiptime, bool startPaused,
                      bool stopWhenFinished, bool stopPrevious) {
     if(stopPrevious && !stack.empty()) {
@@ -131,15 +1323,37 @@ bool ofApp::playClip(size_t slot, float speed, float skiptime, bool startPaused,
             stack.pop_back();
         }
     }
-    // TODO: check if slot is already in stack
+    // a retriggered slot moves to the top: every entry of stack is
+    // updated, stepped and faded once per frame
+    stack.erase(remove(stack.begin(), stack.end(), slot), stack.end());
     speeds[slot] = speed;
     paused[slot] = startPaused;
+    scrubFrames[slot] = -1;
+    stepping[slot] = false;
+    bridgeFrames[slot] = -1;
+    hiddenSince[slot] = 0;
+    parkedTimes[slot] = -1;
+    if(decoders[slot])
+        decoders[slot]->setActive(true);
+    decodeTargets[slot] = -1;
     shouldStop[slot] = stopWhenFinished;
+    opacities[slot] = 1.f;
+    fadeRates[slot] = 0;
+    playheads[slot] = skiptime;
+    clockFrames[slot] = -1;
+    if(followClock)
+        synced[slot] = true;
+    syncFactors[slot] = 1.f;
+    anchorSync(slot, skiptime);
+    reportedTimes[slot] = -1;
+    resetSlotStats(slot);
     auto & mov = movs[slot];
-    if(mov.getSpeed() != speed) {
+    if(mov.getSpeed() != speed && speed > 0) {
         mov.setSpeed(speed);
     }
-    mov.setPaused(startPaused);
+    // headless: the player stays paused, the clock steps it.
+    // Reverse and slow speeds are set up by applySpeed below
+    mov.setPaused(startPaused || headless || residentFull[slot]);
     auto dur = mov.getDuration();
     if(dur <= 0.01) {
         ERR << "Clip too short, dur: " << dur << endl;
@@ -152,14 +1366,31 @@ bool ofApp::playClip(size_t slot, float speed, float skiptime, bool startPaused,
             << "/play message aborted" << endl;
         return false;
     }
-    int frame = static_cast<int>(relpos * mov.getTotalNumFrames());
-    mov.setFrame(frame);
+    int frame = frameAtTime(slot, skiptime);
+    if(headless || residentFull[slot]) {
+        // seeks are left to stepClock, resident slots draw the frame at the
+        // playhead
+    } else if(currentFrame(slot) != frame) {
+        seekFrame(slot, frame);
+        seekTargets[slot] = frame;
+    } else if(usePreroll && prerolls[slot].isAllocated() &&
+              frame == frameAtTime(slot, prerollTimes[slot])) {
+        // parked at the warm-start frame: nothing to seek, show the
+        // preroll texture until the decoder catches up
+        showPreroll[slot] = true;
+    }
+    if(seekTargets[slot] != frame)
+        sendSeeked(slot, frame);
     // setPosition is between 0-1
     // mov.setPosition(relpos);
     drawclip[slot] = true;
+    applySpeed(slot);
     calculateDrawCoords();
     stack.push_back(slot);
     // mov.play();
+    // cue lists mostly run in slot order: get the next one ready
+    if((maxOpen > 0 || memBudgetMB > 0) && slot + 1 < numSlots && loaded[slot+1])
+        ensureOpen(slot + 1);
 
     INFO << "/play - slot:" << slot
          << ", speed:" << speed
@@ -180,358 +1411,1470 @@ size_t ofApp::currentSlot() {
 }
 */
 
-void ofApp::update(){
-    ofxOscMessage msg;
-    while(oscReceiver.hasWaitingMessages()) {
-        oscReceiver.getNextMessage(msg);
-        string addr = msg.getAddress();
-        auto numargs = msg.getNumArgs();
-        if (addr == "/scrub") {
-            if(numargs < 1 || numargs > 2) {
-                ERR << "/scrub expected 1 or 2 args, received " << numargs << endl;
-                ERR << "    /scrub relpos:float [slot:int]";
-                continue;
-            }
-            size_t currSlot = currentSlot();
-            size_t slot = numargs == 2 ? msg.getArgAsInt32(1) : currSlot;
-            if (slot >= numSlots) {
-                ERR << "/stop: invalid slot, " << slot << ", num. slots: " << numSlots << endl;
-                continue;
-            }
-            if (!loaded[slot]) {
-                ERR << "/stop: slot " << slot << " is empty\n";
-                continue;
-            }
-            float pos = msg.getArgAsFloat(0);
-            auto &mov = movs[slot];
-            if(slot != currSlot) {
-                if(currSlot < numSlots)
-                    stopMov(currSlot);
-                mov.setPaused(true);
-                mov.setSpeed(0);
-                drawclip[slot] = true;
-                stack.push_back(slot);
-                calculateDrawCoords();
-            }
-            int totalFrames = mov.getTotalNumFrames();
-            int frame = static_cast<int>(pos * totalFrames);
-            if(frame >= totalFrames)
-                frame = totalFrames - 1;
-            mov.setFrame(frame);
-        }
-        else if(addr == "/scrubabs") {
-            if(numargs < 1 || numargs > 2) {
-                ERR << "/scrub expected 1 or 2 args, received " << numargs << endl;
-                ERR << "    /scrub relpos:float [slot:int]";
-                continue;
-            }
-            size_t currSlot = currentSlot();
-            size_t slot = numargs == 2 ? msg.getArgAsInt32(1) : currSlot;
-            if (slot >= numSlots) {
-                ERR << "/stop: invalid slot, " << slot << ", num. slots: " << numSlots << endl;
-                continue;
-            }
-            if (!loaded[slot]) {
-                ERR << "/stop: slot " << slot << " is empty\n";
-                continue;
-            }
-            float time = msg.getArgAsFloat(0);
-            auto &mov = movs[slot];
-            if(slot != currSlot) {
-                if(currSlot < numSlots)
-                    stopMov(currSlot);
-                mov.setPaused(true);
-                mov.setSpeed(0);
-                drawclip[slot] = true;
-                stack.push_back(slot);
-                calculateDrawCoords();
-            }
-            int totalFrames = mov.getTotalNumFrames();
-            int frame = static_cast<int>((time/durations[slot])*mov.getTotalNumFrames());
-            if(frame >= totalFrames)
-                frame = totalFrames - 1;
-            mov.setFrame(frame);
-            // mov.setPosition(time/durations[slot]);
-        }
-        else if(addr == "/play") {
-            // args: slot, speed, skip(seconds), paused, stop_when_finished
-            if(numargs == 0 || numargs > 5) {
-                ERR << "/play expects 1-5 arguments, got " << numargs << endl
-                    << "    /play slot:int, speed:float=1, skipsecods:float=0, "
-                       "paused:int=0, stopWhenFinished:int=1\n";
-                continue;
-            }
-            size_t slot = msg.getArgAsInt32(0);
-            if(slot >= numSlots) {
-                ERR << "/play: slot "<< slot << " out of range\n";
-                continue;
-            }
-            if(!loaded[slot]) {
-                ERR << "/play: slot "<< slot << " not loaded\n";
-                continue;
-            }
-            float speed = numargs >= 2 ? msg.getArgAsFloat(1) : 1.0f;
-            float skiptime = numargs >= 3 ? msg.getArgAsFloat(2) : 0.0f;
-            int pausestatus = numargs >= 4 ? msg.getArgAsInt32(3) : 0;
-            int stopWhenFinished = numargs >= 5 ? msg.getArgAsInt32(4) : 1;
-            int stopPrevious = numargs >= 6 ? msg.getArgAsInt32(5) : 0;
-            playClip(slot, speed, skiptime, pausestatus, stopWhenFinished, stopPrevious);
-        }
-        else if(addr == "/stop") {
-            size_t slot = numargs == 1 ? msg.getArgAsInt32(0) : currentSlot();
-            if (slot >= numSlots) {
-                ERR << "/stop: invalid slot, " << slot << ", num. slots: " << numSlots << endl;
-                continue;
-            }
-            if (!loaded[slot]) {
-                ERR << "/stop: slot " << slot << " is empty\n";
-                continue;
-            }
-            stopMov(slot);
+//--------------------------------------------------------------
+// OSC api
+//
+// Every command is registered with the types of its arguments, which
+// handleOscMessage validates before calling the handler. The manual
+// printed by printOscApi is generated from the same table.
+//
+// Signatures: one char per argument, i (int), f (float) or s (string).
+// Arguments after a | are optional, a trailing * repeats the last type.
+// Numbers are accepted for both i and f, since many senders (Pd, Max)
+// send every number as float
+
+void ofApp::addOscCommand(const string &address, const string &signature, OscHandler handler,
+                          const string &usage, const string &doc, int slotArg) {
+    OscCommand cmd;
+    cmd.handler = handler;
+    cmd.slotArg = slotArg;
+    cmd.usage = usage;
+    cmd.doc = doc;
+    cmd.minArgs = 0;
+    cmd.maxArgs = 0;
+    bool optional = false;
+    for(char c: signature) {
+        if(c == '|') {
+            optional = true;
+        } else if(c == '*') {
+            cmd.maxArgs = SIZE_MAX;
+        } else {
+            cmd.types += c;
+            cmd.maxArgs++;
+            if(!optional)
+                cmd.minArgs++;
         }
-        else if(addr == "/setpos") {
-            if(numargs != 1) {
-                ERR << "/setpos expected 1 argument, received " << numargs << endl;
-                continue;
-            }
-            if(stack.empty()) {
-                ERR << "/setpos: no active slot\n";
-                continue;
-            }
-            size_t slot = currentSlot();
-            float pos = msg.getArgAsFloat(0);
-            movs[slot].setPosition(pos);
+    }
+    oscCommands[address] = cmd;
+    oscCommandOrder.push_back(address);
+}
+
+void ofApp::registerOscCommands() {
+    addOscCommand("/load", "is|ii", &ofApp::oscLoad,
+                  "/load slot:int path:str [intra:int=0] [resident:int=0]",
+                  "    * Load a video at the given slot. Loading happens in the background,\n"
+                  "      when finished /loaded slot:int ok:int is sent to the oscout address\n"
+                  "      intra: if 1, load an intra-only copy of the clip (transcoded with\n"
+                  "        ffmpeg on first use), for fast seeking\n"
+                  "      resident: if 1, decode every frame of the clip once and play it from\n"
+                  "        memory from then on (within --resident-mb)\n");
+    addOscCommand("/loadfolder", "s|i", &ofApp::oscLoadFolder,
+                  "/loadfolder path:str [watch:int=0]",
+                  "    * Load all clips in a folder. Files must be named XXX_descr.ext, where XXX\n"
+                  "      is the slot number. When finished /loadfolder path:str loaded:int\n"
+                  "      failed:int secs:float is sent to the oscout address. Rejected while\n"
+                  "      another folder is still loading\n"
+                  "      watch: if 1, keep watching the folder and reload the slots of clips\n"
+                  "        which are added, replaced or removed. /unloaded slot:int is sent\n"
+                  "        for removed ones\n");
+    addOscCommand("/play", "i|ffiif", &ofApp::oscPlay,
+                  "/play slot:int [speed:float=1] [starttime:float=0] [paused:int=0] [stopWhenFinished:int=1]\n"
+                  "      [fadetime:float=0]",
+                  "    * Play the given slot with given speed, starting at starttime (secs)\n\n"
+                  "      paused: if 1, the playback will be paused\n"
+                  "      stopWhenFinished: if 1, playback will stop at the end, otherwise it\n"
+                  "        pauses at the last frame\n"
+                  "      fadetime: if given, fade the slot in over the playing one (secs)\n");
+    addOscCommand("/fade", "if|f", &ofApp::oscFade,
+                  "/fade slot:int dur:float [opacity:float=1]",
+                  "    * Fade the opacity of a slot to the given value in dur secs. A slot which\n"
+                  "      is not playing is started from its preroll position and crossfaded\n"
+                  "      over the current one. A slot faded out to 0 is stopped\n");
+    addOscCommand("/opacity", "if", &ofApp::oscOpacity,
+                  "/opacity slot:int opacity:float",
+                  "    * Set the opacity (0-1) of a slot. Slots below a translucent one are\n"
+                  "      visible, up to --layers slots\n");
+    addOscCommand("/clock", "f", &ofApp::oscClock,
+                  "/clock time:float",
+                  "    * Time of the master clock (an audio workstation, for ex.), in secs. Send\n"
+                  "      it regularly (10 times per sec or more); a bundle's timetag, if any,\n"
+                  "      is the moment the time refers to. Synced slots follow this clock\n",
+                  OscCommand::CurrentSlot);
+    addOscCommand("/sync", "i|f", &ofApp::oscSync,
+                  "/sync slot:int [offset:float]",
+                  "    * Lock a slot to the master clock: the clip is at time 0 when the clock\n"
+                  "      is at offset. Without offset, the current position is kept. Drift is\n"
+                  "      corrected by nudging the speed, large errors by seeking. With\n"
+                  "      --master-clock every /play locks its slot\n");
+    addOscCommand("/unsync", "i", &ofApp::oscUnsync,
+                  "/unsync slot:int",
+                  "    * Let a slot run freely again\n");
+    addOscCommand("/syncstatus", "", &ofApp::oscSyncStatus,
+                  "/syncstatus",
+                  "    * Reply with /syncstatus clock:float rate:float valid:int, followed by\n"
+                  "      /syncstatus/slot slot:int errorMs:float speed:float for each synced slot\n");
+    addOscCommand("/stop", "|i", &ofApp::oscStop,
+                  "/stop [slot:int]",
+                  "    * Stop playback. If no slot is given, the currently playing slot is stopped\n");
+    addOscCommand("/pause", "i", &ofApp::oscPause,
+                  "/pause state:int",
+                  "    * If state 1, pause playback, 0 resumes playback\n");
+    addOscCommand("/setspeed", "f", &ofApp::oscSetSpeed,
+                  "/setspeed speed:float",
+                  "    * Change the speed of the playing slot\n"
+                  "      Negative speeds play backwards\n",
+                  OscCommand::CurrentSlot);
+    addOscCommand("/scrub", "f|i", &ofApp::oscScrub,
+                  "/scrub pos:float [slot:int=current]",
+                  "    * Set the relative position 0-1. Sets the given slot as the current slot\n"
+                  "      In scrub mode, video is paused and must be driven externally\n",
+                  1);
+    addOscCommand("/scrubabs", "f|i", &ofApp::oscScrubAbs,
+                  "/scrubabs timepos:float [slot:int=current]",
+                  "    * Set the absolute time and activates the given slot. In scrub mode, video\n"
+                  "      is paused and must be driven externally\n",
+                  1);
+    addOscCommand("/setpos", "f", &ofApp::oscSetPos,
+                  "/setpos pos:float",
+                  "     * Sets the relative (0-1) playing position of the current clip\n"
+                  "       (does not pause the clip like /scrub)\n",
+                  OscCommand::CurrentSlot);
+    addOscCommand("/settime", "f", &ofApp::oscSetTime,
+                  "/settime time:float",
+                  "     * Sets the absolute playing position of the current clip\n"
+                  "       (does not pause the clip like /scrubabs). /play, /scrub, /scrubabs,\n"
+                  "       /settime and /gocue send /seeked slot:int frame:int time:float to the\n"
+                  "       oscout address once the frame they asked for is decoded\n",
+                  OscCommand::CurrentSlot);
+    addOscCommand("/preroll", "if", &ofApp::oscPreroll,
+                  "/preroll slot:int time:float",
+                  "    * Set the warm-start position of a slot (default 0). With --preroll the\n"
+                  "      stopped slot is parked at this frame, so that /play starting there\n"
+                  "      shows its first frame without waiting for a seek\n");
+    addOscCommand("/cue", "isf", &ofApp::oscCue,
+                  "/cue slot:int name:str time:float",
+                  "    * Set a named cue point of a slot (secs, negative removes it). Cues are\n"
+                  "      also read from clip.cues next to the clip, see README\n");
+    addOscCommand("/gocue", "is", &ofApp::oscGoCue,
+                  "/gocue slot:int name:str",
+                  "    * Jump to a cue point of a playing slot\n");
+    addOscCommand("/loop", "i|ff", &ofApp::oscLoop,
+                  "/loop slot:int [in:float out:float]",
+                  "    * Loop a slot between in and out (secs). The first frames of the loop\n"
+                  "      are kept decoded and shown while the player seeks at the wrap.\n"
+                  "      Without in and out, stop looping and play on to the end\n");
+    addOscCommand("/loopcue", "iss", &ofApp::oscLoopCue,
+                  "/loopcue slot:int from:str to:str",
+                  "    * Loop a slot between two of its cue points\n");
+    addOscCommand("/prefetch", "i*", &ofApp::oscPrefetch,
+                  "/prefetch slot:int [slot:int ...]",
+                  "    * With --max-open or --mem-budget, reopen the given slots ahead of\n"
+                  "      their use. Commands for a closed slot wait until it is reopened\n");
+    addOscCommand("/latency", "", &ofApp::oscLatency,
+                  "/latency",
+                  "    * Report OSC latency statistics (receive -> apply -> presented, in ms).\n"
+                  "      Replies /latency recvMean recvP99 presentMean presentP99 timetagErr\n"
+                  "      dropped coalesced\n");
+    addOscCommand("/stats", "f", &ofApp::oscStats,
+                  "/stats rate:float",
+                  "    * Send performance telemetry rate times per sec (0 stops it) to the oscout\n"
+                  "      address, as a bundle of\n"
+                  "        /stats fps updateMs updateMaxMs drawMs drawMaxMs dropped duplicated\n"
+                  "               oscQueue rssMB uploadKB\n"
+                  "        /stats/slot slot lagFrames duplicated memMB syncErrorMs   (each open slot)\n"
+                  "      lagFrames: how far the decoder is behind the clock, in clip frames\n"
+                  "      uploadKB: frame data uploaded to textures per frame\n");
+    addOscCommand("/dump", "*", &ofApp::oscDump,
+                  "/dump",
+                  "    * Dump information about loaded clips\n");
+    addOscCommand("/quit", "", &ofApp::oscQuit,
+                  "/quit",
+                  "    * Quit this application\n");
+}
+
+void ofApp::handleOscMessage(const ofxOscMessage &msg) {
+    auto it = oscCommands.find(msg.getAddress());
+    if(it == oscCommands.end()) {
+        ERR << "Message not recognized: " << msg.getAddress() << endl;
+        return;
+    }
+    const auto &cmd = it->second;
+    size_t numargs = msg.getNumArgs();
+    if(numargs < cmd.minArgs || numargs > cmd.maxArgs) {
+        ERR << msg.getAddress() << ": wrong number of arguments (" << numargs << ")" << endl
+            << "    Syntax: " << cmd.usage << endl;
+        return;
+    }
+    for(size_t i=0; i<numargs && !cmd.types.empty(); i++) {
+        char expected = cmd.types[min(i, cmd.types.size() - 1)];
+        auto type = msg.getArgType(i);
+        bool numeric = type == OFXOSC_TYPE_INT32 || type == OFXOSC_TYPE_INT64 ||
+                       type == OFXOSC_TYPE_FLOAT || type == OFXOSC_TYPE_DOUBLE;
+        bool ok = expected == 's' ? type == OFXOSC_TYPE_STRING : numeric;
+        if(!ok) {
+            ERR << msg.getAddress() << ": argument " << i << " has the wrong type ("
+                << msg.getArgTypeName(i) << ")" << endl
+                << "    Syntax: " << cmd.usage << endl;
+            return;
         }
-        else if(addr == "/settime") {
-            if(numargs != 1) {
-                ERR << "/setpos expected 1 argument, received " << numargs << endl;
-                continue;
-            }
-            if(stack.empty()) {
-                ERR << "/setpos: no active slot\n";
-                continue;
-            }
-            size_t slot = currentSlot();
-            float time = msg.getArgAsFloat(0);
-            auto &mov = movs[slot];
-            int totalFrames = mov.getTotalNumFrames();
-            int frame = static_cast<int>((time/durations[slot])*mov.getTotalNumFrames());
-            if(frame >= totalFrames)
-                frame = totalFrames - 1;
-            mov.setFrame(frame);
-        }
-        else if(addr == "/pause") {
-            if(numargs != 1) {
-                ERR << "/pause expects 1 arguments, got " << numargs << endl
-                    << "    Syntax: /pause pauseStatus:int\n";
-                continue;
-            }
-            size_t slot = currentSlot();
-            if (slot >= numSlots) {
-                ERR << "/pause: invalid slot " << slot << endl;
-            } else if(!loaded[slot]) {
-                ERR << "/pause: slot not loaded: " << slot << endl;
-            } else {
-                int status = msg.getArgAsInt32(0);
-                movs[slot].setPaused(status);
-            }
+    }
+    (this->*cmd.handler)(msg);
+}
+
+bool ofApp::checkSlot(const string &addr, size_t slot) {
+    if(slot >= numSlots) {
+        ERR << addr << ": invalid slot " << slot << ", num. slots: " << numSlots << endl;
+        return false;
+    }
+    if(!loaded[slot]) {
+        ERR << addr << ": slot " << slot << " is empty\n";
+        return false;
+    }
+    return true;
+}
 
+void ofApp::oscScrub(const ofxOscMessage &msg) {
+    size_t currSlot = currentSlot();
+    size_t slot = msg.getNumArgs() == 2 ? msg.getArgAsInt32(1) : currSlot;
+    if(!checkSlot("/scrub", slot))
+        return;
+    if(!ensureOpen(slot)) {
+        deferred.emplace_back(slot, msg);
+        return;
+    }
+    float pos = msg.getArgAsFloat(0);
+    auto &mov = movs[slot];
+    if(slot != currSlot) {
+        if(currSlot < numSlots)
+            stopMov(currSlot);
+        mov.setPaused(true);
+        mov.setSpeed(0);
+        drawclip[slot] = true;
+        stack.erase(remove(stack.begin(), stack.end(), slot), stack.end());
+        stack.push_back(slot);
+        calculateDrawCoords();
+    }
+    scrubTo(slot, frameAtTime(slot, pos * durations[slot]));
+}
+
+void ofApp::oscScrubAbs(const ofxOscMessage &msg) {
+    size_t currSlot = currentSlot();
+    size_t slot = msg.getNumArgs() == 2 ? msg.getArgAsInt32(1) : currSlot;
+    if(!checkSlot("/scrubabs", slot))
+        return;
+    if(!ensureOpen(slot)) {
+        deferred.emplace_back(slot, msg);
+        return;
+    }
+    float time = msg.getArgAsFloat(0);
+    auto &mov = movs[slot];
+    if(slot != currSlot) {
+        if(currSlot < numSlots)
+            stopMov(currSlot);
+        mov.setPaused(true);
+        mov.setSpeed(0);
+        drawclip[slot] = true;
+        stack.erase(remove(stack.begin(), stack.end(), slot), stack.end());
+        stack.push_back(slot);
+        calculateDrawCoords();
+    }
+    scrubTo(slot, frameAtTime(slot, time));
+    // mov.setPosition(time/durations[slot]);
+}
+
+void ofApp::oscPlay(const ofxOscMessage &msg) {
+    // args: slot, speed, skip(seconds), paused, stop_when_finished
+    auto numargs = msg.getNumArgs();
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/play", slot))
+        return;
+    if(!ensureOpen(slot)) {
+        INFO << "/play: slot " << slot << " is closed, playing once it is reopened\n";
+        deferred.emplace_back(slot, msg);
+        return;
+    }
+    float speed = numargs >= 2 ? msg.getArgAsFloat(1) : 1.0f;
+    float skiptime = numargs >= 3 ? msg.getArgAsFloat(2) : 0.0f;
+    int pausestatus = numargs >= 4 ? msg.getArgAsInt32(3) : 0;
+    int stopWhenFinished = numargs >= 5 ? msg.getArgAsInt32(4) : 1;
+    float fadetime = numargs >= 6 ? msg.getArgAsFloat(5) : 0.0f;
+    if(playClip(slot, speed, skiptime, pausestatus, stopWhenFinished, false) && fadetime > 0) {
+        opacities[slot] = 0.f;
+        fadeSlot(slot, 1.f, fadetime, false);
+    }
+}
+
+void ofApp::oscFade(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/fade", slot))
+        return;
+    float dur = msg.getArgAsFloat(1);
+    float target = msg.getNumArgs() >= 3 ? msg.getArgAsFloat(2) : 1.f;
+    bool inStack = find(stack.begin(), stack.end(), slot) != stack.end();
+    if(!inStack) {
+        if(target <= 0)
+            return;
+        if(!ensureOpen(slot)) {
+            deferred.emplace_back(slot, msg);
+            return;
         }
-        else if(addr == "/load") {
-            if(numargs != 2) {
-                ERR << "/load expects 2 arguments, got " << numargs << endl
-                    << "    /load slot:int path:string\n";
-                continue;
-            }
-            int slot = msg.getArgAsInt32(0);
-            if(slot < 0 || slot >= numSlots) {
-                ERR << "/load: slot "<<slot<<" out of range\n";
-                continue;
-            }
+        // start from the warm-start position, so that the fade begins
+        // with a frame which is already decoded
+        if(!playClip(slot, 1.f, prerollTimes[slot], false, shouldStop[slot], false))
+            return;
+        opacities[slot] = 0.f;
+    }
+    fadeSlot(slot, target, dur, true);
+}
 
-            string path = msg.getArgAsString(1);
-            auto ok = loadMov(slot, path);
-            if(!ok) {
-                ERR << "Could not load movie " << path << endl;
-            } else {
-                INFO << "/load - slot:" << slot << ", path:" << path << "\n";
+void ofApp::oscOpacity(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/opacity", slot))
+        return;
+    fadeSlot(slot, msg.getArgAsFloat(1), 0, false);
+}
+
+void ofApp::oscClock(const ofxOscMessage &msg) {
+    masterClock.update(msg.getArgAsDouble(0), batchTime > 0 ? batchTime : OscInput::now());
+}
+
+void ofApp::oscSync(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/sync", slot))
+        return;
+    uint64_t now = OscInput::now();
+    if(msg.getNumArgs() < 2 && !masterClock.valid(now)) {
+        ERR << "/sync: no /clock received, can't keep the position of slot " << slot << endl;
+        return;
+    }
+    synced[slot] = true;
+    syncSeekAt[slot] = 0;
+    if(msg.getNumArgs() >= 2)
+        syncOffsets[slot] = msg.getArgAsDouble(1);
+    else
+        anchorSync(slot, movs[slot].getPosition() * durations[slot]);
+}
+
+void ofApp::oscUnsync(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/unsync", slot))
+        return;
+    unsync(slot);
+}
+
+void ofApp::oscSyncStatus(const ofxOscMessage &msg) {
+    uint64_t now = OscInput::now();
+    bool valid = masterClock.valid(now);
+    INFO << "/syncstatus: clock " << (valid ? ofToString(masterClock.time(now)) : "none")
+         << ", rate " << masterClock.rate();
+    ofxOscBundle bundle;
+    ofxOscMessage status;
+    status.setAddress("/syncstatus");
+    status.addFloatArg(valid ? masterClock.time(now) : 0.f);
+    status.addFloatArg(masterClock.rate());
+    status.addIntArg(valid ? 1 : 0);
+    bundle.addMessage(status);
+    for(size_t slot=0; slot<numSlots; slot++) {
+        if(!synced[slot])
+            continue;
+        INFO << "    slot " << slot << ": error " << syncErrors[slot] * 1000 << " ms, speed x"
+             << syncFactors[slot];
+        ofxOscMessage slotMsg;
+        slotMsg.setAddress("/syncstatus/slot");
+        slotMsg.addIntArg(static_cast<int>(slot));
+        slotMsg.addFloatArg(syncErrors[slot] * 1000.f);
+        slotMsg.addFloatArg(speeds[slot] * syncFactors[slot]);
+        bundle.addMessage(slotMsg);
+    }
+    if(oscOutPort != 0)
+        oscOutput.send(bundle);
+}
+
+void ofApp::anchorSync(size_t slot, float clipTime) {
+    // a synced slot was moved to clipTime: keep it there relative to the
+    // master clock
+    uint64_t now = OscInput::now();
+    if(!synced[slot] || !masterClock.valid(now))
+        return;
+    float speed = speeds[slot] != 0 ? speeds[slot] : 1.f;
+    syncOffsets[slot] = masterClock.time(now) - clipTime / speed;
+    syncErrors[slot] = 0;
+}
+
+void ofApp::unsync(size_t slot) {
+    synced[slot] = false;
+    syncErrors[slot] = 0;
+    bool corrected = syncFactors[slot] != 1.f;
+    syncFactors[slot] = 1.f;
+    if(corrected && isOpen[slot] && drawclip[slot])
+        applySpeed(slot);
+}
+
+void ofApp::updateSync(uint64_t now) {
+    // Keep synced slots at (clock - offset) * speed. Small errors are
+    // corrected within a couple of seconds by running the player up to
+    // 5% faster or slower, so that no frame is visibly skipped; errors
+    // of more than half a second (or 10 frames) are fixed with a seek.
+    // Headless, the playhead is simply set to the clock
+    bool valid = masterClock.valid(now);
+    double master = valid ? masterClock.time(now) : 0;
+    for(auto slot: stack) {
+        if(!synced[slot])
+            continue;
+        auto &mov = movs[slot];
+        if(!valid || !drawclip[slot] || paused[slot] || scrubFrames[slot] >= 0) {
+            // no clock (anymore): run at the nominal speed
+            if(syncFactors[slot] != 1.f) {
+                syncFactors[slot] = 1.f;
+                applySpeed(slot);
             }
+            continue;
         }
-        else if(addr == "/loadfolder") {
-            if(numargs != 1) {
-                ERR << "/loadfolder expects 1 arguments, got " << numargs << endl
-                    << "    Syntax: /loadfolder path:string\n";
-                continue;
-            }
-            // the name pattern is XXX_descr.ext, where XXX is the slot number.
-            // right now we dont do anything with descr
-            string path = msg.getArgAsString(0);
-            bool ok = loadFolder(path);
-            if(!ok) {
-                ERR << "/loadfolder could not load some of the samples \n";
-            }
+        float dur = durations[slot];
+        float target = static_cast<float>((master - syncOffsets[slot]) * speeds[slot]);
+        if(headless || stepping[slot]) {
+            playheads[slot] = ofClamp(target, 0.f, dur);
+            syncErrors[slot] = 0;
+            continue;
         }
-        else if(addr == "/dump") {
-            /*
-            if(numargs != 0) {
-                ERR << "/dump expects 0 arguments, got " << numargs << endl;
+        float actual = slotTime(slot);
+        float err = actual - target;
+        syncErrors[slot] = err;
+        float frameDur = numFrames[slot] > 0 ? dur / numFrames[slot] : 0.04f;
+        if(fabs(err) > max(0.5f, 10 * frameDur)) {
+            // the seek takes a while to show up in the position
+            if(now - syncSeekAt[slot] < 500000 || target < 0 || target >= dur)
                 continue;
-            }
-            */
-            this->dumpClipsInfo();
+            LOG << "sync -- slot " << slot << " off by " << err << " s, seeking";
+            seekFrame(slot, frameAtTime(slot, target));
+            syncSeekAt[slot] = now;
+            continue;
         }
-        else if(addr == "/setspeed") {
-            if(numargs != 1) {
-                ERR << "/setspeed expects 1 arguments, got " << numargs << endl;
-                ERR << "Syntax: /setspeed speed:float  (change the speed of the playing clip)";
-                continue;
-            }
-            size_t slot = currentSlot();
-            if(slot >= numSlots) {
-                ERR << "/setspeed: invalid slot " << slot << endl;
+        // the correction is quantized to 1% steps
+        float factor = fabs(err) < frameDur / 2 ? 1.f : roundf(ofClamp(1.f - err / 2.f, 0.95f, 1.05f) * 100.f) / 100.f;
+        factor *= ofClamp(static_cast<float>(masterClock.rate()), 0.f, 4.f);
+        // every speed change is a flushing seek in the backend: the
+        // correction changes at most once a second, a change of the
+        // clock rate at once
+        if(factor != syncFactors[slot] &&
+           (now - syncSpeedAt[slot] >= 1000000 || fabs(factor - syncFactors[slot]) >= 0.1f)) {
+            syncFactors[slot] = factor;
+            syncSpeedAt[slot] = now;
+            applySpeed(slot);
+        }
+    }
+}
+
+void ofApp::oscStop(const ofxOscMessage &msg) {
+    size_t slot = msg.getNumArgs() == 1 ? msg.getArgAsInt32(0) : currentSlot();
+    if(!checkSlot("/stop", slot))
+        return;
+    stopMov(slot);
+}
+
+void ofApp::oscSetPos(const ofxOscMessage &msg) {
+    if(stack.empty()) {
+        ERR << "/setpos: no active slot\n";
+        return;
+    }
+    size_t slot = currentSlot();
+    float pos = msg.getArgAsFloat(0);
+    scrubFrames[slot] = -1;
+    decodeTargets[slot] = -1;
+    anchorSync(slot, pos * durations[slot]);
+    if(headless || stepping[slot]) {
+        playheads[slot] = pos * durations[slot];
+        clockFrames[slot] = -1;
+        return;
+    }
+    movs[slot].setPosition(pos);
+    numSeeks++;
+    resetSlotStats(slot);
+}
+
+void ofApp::oscSetTime(const ofxOscMessage &msg) {
+    if(stack.empty()) {
+        ERR << "/settime: no active slot\n";
+        return;
+    }
+    jumpTo(currentSlot(), msg.getArgAsFloat(0));
+}
+
+void ofApp::jumpTo(size_t slot, float time) {
+    // move the playing slot to time, secs
+    scrubFrames[slot] = -1;
+    decodeTargets[slot] = -1;
+    anchorSync(slot, time);
+    int frame = frameAtTime(slot, time);
+    if(headless || stepping[slot]) {
+        playheads[slot] = time;
+        clockFrames[slot] = -1;
+        sendSeeked(slot, frame);
+        return;
+    }
+    seekFrame(slot, frame);
+    seekTargets[slot] = frame;
+}
+
+void ofApp::oscPause(const ofxOscMessage &msg) {
+    size_t slot = currentSlot();
+    if(!checkSlot("/pause", slot))
+        return;
+    int status = msg.getArgAsInt32(0);
+    paused[slot] = status;
+    resetSlotStats(slot);
+    // a wrapping loop resumes the player itself, see updateLoop
+    if(!headless && !stepping[slot] && bridgeFrames[slot] < 0)
+        movs[slot].setPaused(status);
+}
+
+void ofApp::oscLoad(const ofxOscMessage &msg) {
+    int slot = msg.getArgAsInt32(0);
+    if(slot < 0 || slot >= numSlots) {
+        ERR << "/load: slot "<<slot<<" out of range\n";
+        return;
+    }
+    string path = msg.getArgAsString(1);
+    bool intra = msg.getNumArgs() >= 3 && msg.getArgAsInt32(2) != 0;
+    bool ram = msg.getNumArgs() >= 4 && msg.getArgAsInt32(3) != 0;
+    auto ok = loadMov(slot, path, false, intra, ram);
+    if(!ok) {
+        ERR << "Could not load movie " << path << endl;
+    } else {
+        INFO << "/load - slot:" << slot << ", path:" << path << " (queued)\n";
+    }
+}
+
+void ofApp::oscLoadFolder(const ofxOscMessage &msg) {
+    // the name pattern is XXX_descr.ext, where XXX is the slot number.
+    // right now we dont do anything with descr
+    string path = msg.getArgAsString(0);
+    bool watch = msg.getNumArgs() == 2 && msg.getArgAsInt32(1) != 0;
+    bool ok = loadFolder(path, watch);
+    if(!ok) {
+        ERR << "/loadfolder could not load some of the samples \n";
+    }
+}
+
+void ofApp::oscPreroll(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/preroll", slot))
+        return;
+    float time = msg.getArgAsFloat(1);
+    if(time < 0 || time >= durations[slot]) {
+        ERR << "/preroll: time " << time << " out of bounds, clip duration: "
+            << durations[slot] << endl;
+        return;
+    }
+    prerollTimes[slot] = time;
+    if(usePreroll && !drawclip[slot] && isOpen[slot])
+        parkAtPreroll(slot);
+}
+
+void ofApp::oscCue(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/cue", slot))
+        return;
+    string name = msg.getArgAsString(1);
+    float time = msg.getArgAsFloat(2);
+    if(time < 0) {
+        cues[slot].points.erase(name);
+        return;
+    }
+    if(time >= durations[slot]) {
+        ERR << "/cue: time " << time << " out of bounds, clip duration: "
+            << durations[slot] << endl;
+        return;
+    }
+    cues[slot].points[name] = time;
+}
+
+void ofApp::oscGoCue(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/gocue", slot))
+        return;
+    string name = msg.getArgAsString(1);
+    float time;
+    if(!cues[slot].find(name, time)) {
+        ERR << "/gocue: slot " << slot << " has no cue " << name << endl;
+        return;
+    }
+    if(!drawclip[slot]) {
+        ERR << "/gocue: slot " << slot << " is not playing\n";
+        return;
+    }
+    jumpTo(slot, time);
+}
+
+void ofApp::oscLoop(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/loop", slot))
+        return;
+    if(msg.getNumArgs() == 1) {
+        setLoop(slot, 0, 0);
+        return;
+    }
+    if(msg.getNumArgs() != 3) {
+        ERR << "/loop: expected in and out\n";
+        return;
+    }
+    setLoop(slot, msg.getArgAsFloat(1), msg.getArgAsFloat(2));
+}
+
+void ofApp::oscLoopCue(const ofxOscMessage &msg) {
+    size_t slot = msg.getArgAsInt32(0);
+    if(!checkSlot("/loopcue", slot))
+        return;
+    string from = msg.getArgAsString(1);
+    string to = msg.getArgAsString(2);
+    float in, out;
+    if(!cues[slot].find(from, in) || !cues[slot].find(to, out)) {
+        ERR << "/loopcue: slot " << slot << " has no cue " << from << " or " << to << endl;
+        return;
+    }
+    setLoop(slot, in, out);
+}
+
+void ofApp::oscPrefetch(const ofxOscMessage &msg) {
+    for(size_t i=0; i<msg.getNumArgs(); i++) {
+        size_t slot = msg.getArgAsInt32(i);
+        if(checkSlot("/prefetch", slot))
+            ensureOpen(slot);
+    }
+}
+
+void ofApp::oscLatency(const ofxOscMessage &msg) {
+    this->reportLatency();
+}
+
+void ofApp::oscStats(const ofxOscMessage &msg) {
+    float rate = msg.getArgAsFloat(0);
+    if(rate > 0 && oscOutPort == 0) {
+        ERR << "/stats: no oscout address to send to\n";
+        return;
+    }
+    statsRate = max(rate, 0.f);
+    // the first report starts a new window
+    statsWindow.started = 0;
+    INFO << "/stats: " << (statsRate > 0 ? ofToString(statsRate) + " per sec" : "off");
+}
+
+void ofApp::oscDump(const ofxOscMessage &msg) {
+    this->dumpClipsInfo();
+}
+
+void ofApp::oscSetSpeed(const ofxOscMessage &msg) {
+    size_t slot = currentSlot();
+    if(!checkSlot("/setspeed", slot))
+        return;
+    float speed = msg.getArgAsFloat(0);
+    INFO << "/setspeed slot: " << slot << ", value: " << speed << endl;
+    float time = slotTime(slot);
+    playheads[slot] = time;
+    speeds[slot] = speed;
+    applySpeed(slot);
+    anchorSync(slot, time);
+}
+
+void ofApp::oscQuit(const ofxOscMessage &msg) {
+    ofExit();
+}
+
+void ofApp::receiveOsc() {
+    // All messages of a bundle are applied together in the same frame. A
+    // bundle with a timetag in the future waits in the schedule and is
+    // applied in the frame whose update is closest to its due time
+    uint64_t now = OscInput::now();
+    auto horizon = now + static_cast<uint64_t>(ofGetLastFrameTime() * 500000.0);
+    while(!scheduled.empty() && scheduled.begin()->first <= horizon) {
+        applyBatch(scheduled.begin()->second);
+        scheduled.erase(scheduled.begin());
+    }
+    OscBatch batch;
+    vector<OscBatch> batches;
+    while(oscInput.next(batch)) {
+        if(oscRecord.is_open()) {
+            for(const auto &msg: batch.messages)
+                oscRecord << formatTraceLine(batch.received - recordStart, msg) << "\n";
+        }
+        if(!followers.empty())
+            lead(batch, now);
+        if(batch.due > horizon) {
+            LOG << "scheduling bundle in " << (batch.due - now) / 1000 << " ms";
+            scheduled.emplace(batch.due, std::move(batch));
+            continue;
+        }
+        if(batch.due > 0 && batch.due + 1000 < now)
+            LOG << "bundle arrived " << (now - batch.due) / 1000 << " ms late";
+        batches.push_back(std::move(batch));
+    }
+    if(coalesceOsc && batches.size() > 1)
+        coalesce(batches);
+    for(const auto &b: batches)
+        applyBatch(b);
+}
+
+void ofApp::addFollower(const string &host, int port) {
+    followers.emplace_back(new OscOutput());
+    followers.back()->setup(host, port);
+}
+
+void ofApp::lead(OscBatch &batch, uint64_t now) {
+    // Leader: every command is passed on to the followers in a bundle
+    // timetagged slightly in the future, and applied here at that same
+    // time. All instances then apply it in the frame closest to the due
+    // time, which with a shared vsync is the same frame
+    if(batch.due < now + syncLead)
+        batch.due = now + syncLead;
+    ofxOscBundle bundle;
+    for(const auto &msg: batch.messages)
+        bundle.addMessage(msg);
+    uint64_t timetag = OscInput::localToTimetag(batch.due);
+    for(auto &follower: followers)
+        follower->send(bundle, timetag);
+}
+
+void ofApp::sendLeaderClock(uint64_t now) {
+    // the followers' slots are locked to the leader's clock, as are ours.
+    // Timetagged with now, so that the time it takes to arrive does not
+    // count
+    double t = (now - leaderStart) / 1000000.0;
+    masterClock.update(t, now);
+    ofxOscMessage msg;
+    msg.setAddress("/clock");
+    msg.addDoubleArg(t);
+    ofxOscBundle bundle;
+    bundle.addMessage(msg);
+    uint64_t timetag = OscInput::localToTimetag(now);
+    for(auto &follower: followers)
+        follower->send(bundle, timetag);
+}
+
+void ofApp::coalesce(vector<OscBatch> &batches) {
+    // Of the idempotent commands received during one frame only the last
+    // one per address and slot is kept. Other commands (/play, /stop,
+    // /load, ...) act as barriers: nothing is collapsed across them, so
+    // their order relative to the rest is preserved
+    set<pair<string, int>> seen;
+    for(auto b = batches.rbegin(); b != batches.rend(); ++b) {
+        auto &msgs = b->messages;
+        for(int i = static_cast<int>(msgs.size()) - 1; i >= 0; i--) {
+            auto it = oscCommands.find(msgs[i].getAddress());
+            if(it == oscCommands.end() || it->second.slotArg == OscCommand::NotCoalesced) {
+                seen.clear();
                 continue;
             }
-            if(!loaded[slot]) {
-                ERR << "/setspeed: slot "<< slot <<" not loaded\n";
+            int slotArg = it->second.slotArg;
+            // -1 stands for the current slot
+            int slot = -1;
+            if(slotArg >= 0 && msgs[i].getNumArgs() > static_cast<size_t>(slotArg) &&
+               msgs[i].getArgType(slotArg) != OFXOSC_TYPE_STRING)
+                slot = msgs[i].getArgAsInt32(slotArg);
+            if(seen.insert(make_pair(msgs[i].getAddress(), slot)).second)
                 continue;
-            }
-            float speed = msg.getArgAsFloat(0);
-            INFO << "/setspeed slot: " << slot << ", value: " << speed << endl;
-            movs[slot].setSpeed(speed);
-            speeds[slot] = speed;
+            msgs.erase(msgs.begin() + i);
+            numCoalesced++;
         }
-        else {
-            ERR << "Message not recognized: " << addr << endl;
+    }
+    batches.erase(remove_if(batches.begin(), batches.end(),
+                            [](const OscBatch &b) { return b.messages.empty(); }),
+                  batches.end());
+}
+
+void ofApp::applyBatch(const OscBatch &batch) {
+    uint64_t t = OscInput::now();
+    if(batch.due > 0)
+        scheduleError.add(t > batch.due ? t - batch.due : batch.due - t);
+    else
+        receiveToApply.add(t - batch.received);
+    appliedAt.push_back(t);
+    batchTime = batch.due > 0 ? batch.due : batch.received;
+    for(const auto &msg: batch.messages)
+        handleOscMessage(msg);
+    batchTime = 0;
+}
+
+void ofApp::reportLatency() {
+    auto ms = [](double us) { return static_cast<float>(us / 1000.0); };
+    INFO << "OSC latency (ms), " << receiveToApply.count() << " messages, "
+         << oscInput.dropped() << " dropped, " << numCoalesced << " coalesced" << endl
+         << "    receive -> apply:   mean " << ms(receiveToApply.mean())
+         << ", p99 " << ms(receiveToApply.percentile(0.99))
+         << ", max " << ms(receiveToApply.max()) << endl
+         << "    apply -> presented: mean " << ms(applyToPresent.mean())
+         << ", p99 " << ms(applyToPresent.percentile(0.99))
+         << ", max " << ms(applyToPresent.max()) << endl
+         << "    timetag error:      mean " << ms(scheduleError.mean())
+         << ", p99 " << ms(scheduleError.percentile(0.99)) << endl;
+    if(oscOutPort == 0)
+        return;
+    ofxOscMessage msg;
+    msg.setAddress("/latency");
+    msg.addFloatArg(ms(receiveToApply.mean()));
+    msg.addFloatArg(ms(receiveToApply.percentile(0.99)));
+    msg.addFloatArg(ms(applyToPresent.mean()));
+    msg.addFloatArg(ms(applyToPresent.percentile(0.99)));
+    msg.addFloatArg(ms(scheduleError.mean()));
+    msg.addIntArg(static_cast<int>(oscInput.dropped()));
+    msg.addIntArg(static_cast<int>(numCoalesced));
+    oscOutput.send(msg);
+}
+
+void ofApp::reportBenchmark() {
+    // p50/p99/max of everything measured since the start, in ms
+    auto ms = [](double us) { return static_cast<float>(us / 1000.0); };
+    auto row = [&ms](const string &name, const Stats &st) {
+        cout << "    " << name << string(max(0, 22 - static_cast<int>(name.size())), ' ')
+             << setw(9) << ms(st.percentile(0.5)) << setw(9) << ms(st.percentile(0.99))
+             << setw(9) << ms(st.max()) << "   (" << st.count() << ")\n";
+    };
+    float secs = (OscInput::now() - benchStart) / 1000000.f;
+    cout << fixed << setprecision(3)
+         << "\nBenchmark: " << ofGetFrameNum() << " frames in " << secs << " s";
+    if(!replayPath.empty())
+        cout << ", trace " << replayPath << " (" << replayer.size() << " messages)";
+    cout << "\n" << string(26, ' ') << "      p50      p99      max   (samples)\n";
+    row("update", updateTimes);
+    row("draw", drawTimes);
+    row("frame interval", frameIntervals);
+    row("receive -> apply", receiveToApply);
+    row("apply -> presented", applyToPresent);
+    row("timetag error", scheduleError);
+    cout << "    seeks: " << numSeeks << " (" << numSeeks / max(secs, 0.001f) << "/s)"
+         << ", dropped frames: " << numDroppedFrames
+         << ", dropped OSC: " << oscInput.dropped() << " in, " << oscOutput.dropped() << " out"
+         << ", coalesced: " << numCoalesced << "\n"
+         << "    uploaded: " << uploadedBytes / 1024.0 / max(ofGetFrameNum(), (uint64_t)1)
+         << " KB/frame" << (yuvUpload ? " (planar YUV)" : "") << "\n";
+    if(decodeThreads) {
+        uint64_t dropped = 0;
+        for(const auto &decoder: decoders)
+            dropped += decoder ? decoder->dropped() : 0;
+        cout << "    decode threads: " << numSkippedFrames << " frames skipped at presentation, "
+             << dropped << " dropped by full queues\n";
+    }
+    cout.unsetf(ios::floatfield);
+    cout.precision(6);
+}
+
+static float residentMemoryMB() {
+    // resident set size of the whole process, linux only
+    long pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    if(!(statm >> pages >> resident))
+        return 0;
+    return static_cast<float>(resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+}
+
+size_t ofApp::slotResidentMemory(size_t slot) {
+    // estimated memory held by slot: its decoder if open, plus the
+    // textures of its preroll and scrub cache
+    size_t bytes = isOpen[slot] ? slotMemory(slot) : 0;
+    if(prerolls[slot].isAllocated())
+        bytes += static_cast<size_t>(prerolls[slot].getWidth() * prerolls[slot].getHeight() * 3);
+    return bytes + scrubCaches[slot].memory();
+}
+
+void ofApp::resetSlotStats(size_t slot) {
+    // after a seek, a pause or a new /play the frames of slot can't be
+    // compared to the clock until the next window
+    statsFrames[slot] = -1;
+    newFrameAt[slot] = 0;
+}
+
+void ofApp::countNewFrame(size_t slot, uint64_t now) {
+    // a clip frame which arrives late means the previous one stayed on
+    // screen longer than it should: count the frames it stands in for
+    auto &mov = movs[slot];
+    if(newFrameAt[slot] > 0 && !mov.isPaused() && scrubFrames[slot] < 0 && durations[slot] > 0) {
+        float fps = numFrames[slot] / durations[slot] * fabs(speeds[slot]);
+        int missed = static_cast<int>(round((now - newFrameAt[slot]) * fps / 1000000.0)) - 1;
+        if(missed > 0) {
+            slotDuplicated[slot] += missed;
+            statsWindow.duplicated += missed;
         }
-    } // finished with OSC
+    }
+    newFrameAt[slot] = now;
+}
 
-    for(const auto &slot: stack) {
-        auto &mov = movs[slot];
-        if(mov.getIsMovieDone()) {
-            mov.setPaused(true);
-            // mov.stop();
-            if( shouldStop[slot] ) {
-                drawclip[slot] = false;
-                // mov.setPosition(0.f);
+void ofApp::sendStats(uint64_t now) {
+    // One bundle per report, for the window since the previous one. The
+    // lag of a slot is how many clip frames its decoder is behind the
+    // frames which should have been shown since the window started
+    auto &w = statsWindow;
+    float secs = (now - w.started) / 1000000.f;
+    if(w.started > 0 && oscOutPort != 0 && secs > 0) {
+        auto ms = [](double us) { return static_cast<float>(us / 1000.0); };
+        uint64_t frames = max(w.frames, (uint64_t)1);
+        ofxOscBundle bundle;
+        ofxOscMessage msg;
+        msg.setAddress("/stats");
+        msg.addFloatArg(w.frames / secs);
+        msg.addFloatArg(ms(static_cast<double>(w.updateTime) / frames));
+        msg.addFloatArg(ms(w.updateMax));
+        msg.addFloatArg(ms(static_cast<double>(w.drawTime) / frames));
+        msg.addFloatArg(ms(w.drawMax));
+        msg.addIntArg(static_cast<int>(w.dropped));
+        msg.addIntArg(static_cast<int>(w.duplicated));
+        msg.addIntArg(static_cast<int>(oscInput.pending() + scheduled.size()));
+        msg.addFloatArg(residentMemoryMB());
+        msg.addFloatArg(w.uploaded / 1024.f / frames);
+        bundle.addMessage(msg);
+        for(size_t slot=0; slot<numSlots; slot++) {
+            if(!isOpen[slot])
+                continue;
+            auto &mov = movs[slot];
+            float lag = 0;
+            bool playing = drawclip[slot] && !mov.isPaused() && scrubFrames[slot] < 0;
+            if(playing && statsFrames[slot] >= 0 && durations[slot] > 0) {
+                float expected = secs * speeds[slot] * numFrames[slot] / durations[slot];
+                lag = expected - (currentFrame(slot) - statsFrames[slot]);
             }
+            ofxOscMessage slotMsg;
+            slotMsg.setAddress("/stats/slot");
+            slotMsg.addIntArg(static_cast<int>(slot));
+            slotMsg.addFloatArg(lag);
+            slotMsg.addIntArg(static_cast<int>(slotDuplicated[slot]));
+            slotMsg.addFloatArg(slotResidentMemory(slot) / (1024.f * 1024.f));
+            slotMsg.addFloatArg(synced[slot] ? syncErrors[slot] * 1000.f : 0.f);
+            bundle.addMessage(slotMsg);
         }
-        else if(mov.isPlaying()) {
-            mov.update();
+        oscOutput.send(bundle);
+    }
+    w = StatsWindow{now, 0, 0, 0, 0, 0, 0, 0, 0};
+    for(size_t slot=0; slot<numSlots; slot++) {
+        slotDuplicated[slot] = 0;
+        statsFrames[slot] = isOpen[slot] ? currentFrame(slot) : -1;
+    }
+}
+
+void ofApp::update(){
+    uint64_t now = OscInput::now();
+    // the previous frame has been swapped, its commands are on screen
+    if(!appliedAt.empty()) {
+        for(auto t: appliedAt)
+            applyToPresent.add(now - t);
+        appliedAt.clear();
+    }
+    if(lastUpdateStart > 0) {
+        // a frame took more than 1.5 times its period: at least one
+        // vsync was missed
+        uint64_t interval = now - lastUpdateStart;
+        float fps = ofGetTargetFrameRate() > 0 ? ofGetTargetFrameRate() : 60.f;
+        frameIntervals.add(interval);
+        if(!headless && interval > 1500000.0 / fps) {
+            numDroppedFrames++;
+            statsWindow.dropped++;
         }
     }
+    lastUpdateStart = now;
+    statsWindow.frames++;
+    if(statsRate > 0 && now - statsWindow.started >= 1000000.0 / statsRate)
+        sendStats(now);
+    if(replayer.finished() && !replayPath.empty()) {
+        // give the last commands of the trace a second to take effect
+        if(replayDoneAt == 0)
+            replayDoneAt = now;
+        else if(benchmark && now - replayDoneAt > 1000000)
+            ofExit();
+    }
 
-    size_t slot = currentSlot();
-    if(oscOutPort != 0 and slot < numSlots) {
-        ofxOscMessage msg;
-        auto &mov = movs[slot];
-        auto dur = durations[slot];
-        auto time = mov.getPosition() * dur;
-        if(time >= 0 && (
-                lastOscMsg.getNumArgs() != 3 ||
-                lastOscMsg.getAddress() != "/play" ||
-                lastOscMsg.getArgAsInt(0) != slot ||
-                abs(lastOscMsg.getArgAsFloat(1) - time) > 1e-7f)) {
-            msg.setAddress("/play");
-            msg.addIntArg(slot);
-            msg.addFloatArg(time);
-            msg.addFloatArg(dur);
-            oscSender.sendMessage(msg);
-            lastOscMsg = msg;
+    updateLoads();
+
+    if(folderWatch.watching() || !pendingUnloads.empty())
+        updateWatch();
+
+    receiveOsc();
+
+    fillFrameStores();
+
+    if(!prerollQueue.empty())
+        updatePrerolls();
+
+    updateFades();
+
+    if(!followers.empty())
+        sendLeaderClock(now);
+    updateSync(now);
+
+    if(headless) {
+        stepClock();
+    } else {
+        updateVisibility(now);
+        for(const auto &slot: stack) {
+            auto &mov = movs[slot];
+            if(stepping[slot]) {
+                if(drawclip[slot])
+                    stepSlot(slot, now);
+                continue;
+            }
+            if(cues[slot].looping() && scrubFrames[slot] < 0 && drawclip[slot]) {
+                updatePlayer(slot);
+                if(frameNew[slot])
+                    countNewFrame(slot, now);
+                if(showPreroll[slot] && frameNew[slot])
+                    showPreroll[slot] = false;
+                updateLoop(slot);
+                continue;
+            }
+            if(mov.getIsMovieDone()) {
+                mov.setPaused(true);
+                // mov.stop();
+                if( shouldStop[slot] ) {
+                    drawclip[slot] = false;
+                    // mov.setPosition(0.f);
+                }
+            }
+            else if(hiddenSince[slot] > 0) {
+                // covered by the slots above, see updateVisibility
+            }
+            else if(mov.isPlaying()) {
+                updatePlayer(slot);
+                if(frameNew[slot])
+                    countNewFrame(slot, now);
+                if(showPreroll[slot] && frameNew[slot])
+                    showPreroll[slot] = false;
+                if(scrubFrames[slot] >= 0 && scrubCaches[slot].enabled())
+                    updateScrubCache(slot);
+            }
         }
     }
 
+    sendPositions(now);
+    uint64_t elapsed = OscInput::now() - now;
+    updateTimes.add(elapsed);
+    statsWindow.updateTime += elapsed;
+    statsWindow.updateMax = max(statsWindow.updateMax, elapsed);
 }
 
-void ofApp::calculateDrawCoords() {
-    size_t currSlot = stack.empty() ? numSlots+1 : stack[stack.size()-1];
-    if(currSlot >= numSlots || !loaded[currSlot]) {
-        draw_x0 = 0;
-        draw_y0 = 0;
-        draw_height = ofGetWindowHeight();
-        draw_width = ofGetWindowWidth();
+void ofApp::sendPositions(uint64_t now) {
+    // Report the position of the current slot as /play slot time dur, at
+    // most positionRate times per sec and only if it moved by more than
+    // positionDelta since it was last reported. With positionBundle every
+    // visible slot which moved is reported, all in one bundle
+    if(oscOutPort == 0)
+        return;
+    if(positionRate > 0 && now - lastPositionAt < 1000000.0 / positionRate)
         return;
+    lastPositionAt = now;
+    float delta = max(positionDelta, 1e-7f);
+    auto moved = [this, delta](size_t slot, float time) {
+        return time >= 0 && (reportedTimes[slot] < 0 || fabs(reportedTimes[slot] - time) > delta);
+    };
+    auto position = [this](size_t slot) {
+        ofxOscMessage msg;
+        msg.setAddress("/play");
+        msg.addIntArg(slot);
+        msg.addFloatArg(reportedTimes[slot]);
+        msg.addFloatArg(durations[slot]);
+        return msg;
+    };
+    if(!positionBundle) {
+        size_t slot = currentSlot();
+        if(slot >= numSlots)
+            return;
+        float time = slotTime(slot);
+        if(!moved(slot, time) && slot == lastPositionSlot)
+            return;
+        reportedTimes[slot] = time;
+        lastPositionSlot = slot;
+        oscOutput.send(position(slot));
+        return;
+    }
+    ofxOscBundle bundle;
+    for(auto slot: stack) {
+        if(!drawclip[slot])
+            continue;
+        float time = slotTime(slot);
+        if(!moved(slot, time))
+            continue;
+        reportedTimes[slot] = time;
+        bundle.addMessage(position(slot));
     }
-    auto mov = &(movs[currSlot]);
+    if(bundle.getMessageCount() > 0)
+        oscOutput.send(bundle);
+}
+
+ofRectangle ofApp::fitToWindow(size_t slot) {
+    // the largest rectangle with the aspect ratio of the clip which fits
+    // the window, centered
     int windowWidth = ofGetWindowWidth();
     int windowHeight = ofGetWindowHeight();
-    float movWidth = mov->getWidth();
-    float movHeight = mov->getHeight();
+    if(slot >= numSlots || !loaded[slot] || widths[slot] <= 0 || heights[slot] <= 0)
+        return ofRectangle(0, 0, windowWidth, windowHeight);
+    float movWidth = widths[slot];
+    float movHeight = heights[slot];
     float wr = windowWidth / movWidth;
     float hr = windowHeight / movHeight;
     float draw_h, draw_w;
+    int x0, y0;
     if (hr < wr) {
         draw_h = windowHeight;
         draw_w = draw_h * (movWidth / movHeight);
-        draw_x0 = (windowWidth - static_cast<int>(draw_w)) / 2;
-        draw_y0 = 0;
+        x0 = (windowWidth - static_cast<int>(draw_w)) / 2;
+        y0 = 0;
     } else {
         draw_w = windowWidth;
         draw_h = draw_w * (movHeight / movWidth);
-        draw_x0 = 0;
-        draw_y0 = (windowHeight - static_cast<int>(draw_h)) / 2;
+        x0 = 0;
+        y0 = (windowHeight - static_cast<int>(draw_h)) / 2;
     }
-    draw_height = int(draw_h);
-    draw_width = int(draw_w);
+    return ofRectangle(x0, y0, int(draw_w), int(draw_h));
+}
+
+void ofApp::calculateDrawCoords() {
+    ofRectangle r = fitToWindow(currentSlot());
+    draw_x0 = static_cast<int>(r.x);
+    draw_y0 = static_cast<int>(r.y);
+    draw_width = static_cast<int>(r.width);
+    draw_height = static_cast<int>(r.height);
     INFO << "height: " << draw_height << ", width: " << draw_width;
 }
 
-bool ofApp::loadFolder(const string &path) {
+static const vector<string> clipExtensions = {"mp4", "mkv", "mpg", "avi", "ogv", "m4v", "mov"};
+
+static int slotFromFilename(const string &filename) {
+    // the XXX of XXX_descr.ext, -1 if filename does not have that format
+    auto delim = filename.find("_");
+    // dont accept extremely long names
+    if (delim == string::npos || delim == 0 || delim >= 100 ||
+        !all_of(filename.begin(), filename.begin()+delim, ::isdigit))
+        return -1;
+    return std::stoi(filename.substr(0, delim));
+}
+
+bool ofApp::loadFolder(const string &path, bool watch) {
     // the name pattern is XXX_descr.ext, where XXX is the slot number.
     // right now we dont do anything with descr
+    // Clips are queued and loaded in the background, maxLoads at a time.
+    // Files which can't be loaded are skipped and a summary is reported
+    // once the whole folder has been processed.
     // returns true if ok, false if errors
     ofDirectory dir(path);
-    dir.allowExt("mp4");
-    dir.allowExt("mkv");
-    dir.allowExt("mpg");
-    dir.allowExt("avi");
-    dir.allowExt("ogv");
-    dir.allowExt("m4v");
-    dir.allowExt("mov");
+    if(!dir.exists()) {
+        ERR << "/loadfolder: folder not found: " << path << endl;
+        return false;
+    }
+    for(const auto &ext: clipExtensions)
+        dir.allowExt(ext);
     //populate the directory object
     dir.listDir();
 
+    // the summary counts one folder: a second one has to wait
+    if(loadBatch.pending > 0) {
+        ERR << "/loadfolder: previous folder " << loadBatch.path << " still loading, "
+            << loadBatch.pending << " clips pending. Not loading " << path << endl;
+        return false;
+    }
+    // one pending count is held for the scan itself: clips which load
+    // right away (see useClipIndex) can't bring pending down to 0 before
+    // the whole folder has been queued
+    loadBatch = LoadBatch{path, 1, 0, 0, ofGetElapsedTimeMillis(), 0, 0};
+    bool ok = true;
     for(size_t i = 0; i < dir.size(); i++){
         string filename = dir.getName(i);
         LOG << "loadFolder: loading " << filename << endl;
-        auto delim = filename.find("_");
-        // dont accept extremely long names
-        if (delim >= 100) {
+        int slot = slotFromFilename(filename);
+        if(slot < 0) {
             ERR << "/loadfolder: filename should have the format XXX_descr.ext\n"
                 << "   filename: " << filename << endl;
-            return false;
+            loadBatch.failed++;
+            ok = false;
+            continue;
+        }
+        if(slot >= numSlots) {
+            ERR << "Slot out of range: " << slot << ", num slots: " << numSlots << endl
+                << "    filename: " << filename << endl;
+            loadBatch.failed++;
+            ok = false;
+            continue;
+        }
+        size_t idx = static_cast<size_t>(slot);
+        if(loaded[idx]) {
+            INFO << "/loadfolder: loading a clip in an already used slot\n"
+                 << "    Slot: " << slot << endl
+                 << "    New clip: " << filename << endl
+                 << "    Previous clip: " << paths[idx] << endl;
+        }
+        LOG << "loading slot: " << slot << ", path: " << dir.getPath(i);
+        loadBatch.pending++;
+        if(!this->loadMov(slot, dir.getPath(i), true, intraOnLoad)) {
+            loadBatch.pending--;
+            ERR << "Could not load clip num " << i << " path: " << dir.getPath(i) << endl;
+            loadBatch.failed++;
+            ok = false;
+        }
+    }
+    INFO << "/loadfolder: " << loadBatch.pending - 1 << " clips pending from " << path
+         << ", loading " << maxLoads << " at a time\n";
+    // release the scan's count. With nothing pending (an empty folder,
+    // only bad names, all clips indexed) the folder is done already
+    loadBatch.pending--;
+    if(loadBatch.pending == 0)
+        reportBatch();
+    if(watch) {
+        if(folderWatch.setup(dir.getAbsolutePath(), watchSettle))
+            INFO << "/loadfolder: watching " << path << " for changes\n";
+        else
+            ok = false;
+    } else if(folderWatch.watching()) {
+        folderWatch.close();
+    }
+    return ok;
+}
+
+void ofApp::updateWatch() {
+    // Reload the slots whose clips were added, replaced or removed in the
+    // watched folder. Reloads run in the background like any load: a slot
+    // on screen plays its old clip until the new one is ready and then
+    // goes on from the same time, see finishLoad
+    auto it = pendingUnloads.begin();
+    while(it != pendingUnloads.end()) {
+        if(find(stack.begin(), stack.end(), *it) == stack.end()) {
+            unloadSlot(*it);
+            it = pendingUnloads.erase(it);
         } else {
-            int slot = std::stoi(filename.substr(0, delim));
-            if(slot < 0 || slot >= numSlots) {
-                ERR << "Slot out of range: " << slot << ", num slots: " << numSlots << endl
-                    << "    filename: " << filename << endl;
-                continue;
-            }
-            size_t idx = static_cast<size_t>(slot);
-            if(loaded[idx]) {
-                INFO << "/loadfolder: loading a clip in an already used slot\n"
-                     << "    Slot: " << slot << endl
-                     << "    New clip: " << filename << endl
-                     << "    Previous clip: " << movs[idx].getMoviePath() << endl;
-            }
-            LOG << "loading slot: " << slot << ", path: " << dir.getPath(i);
-            auto ok = this->loadMov(slot, dir.getPath(i));
-            if(!ok) {
-                ERR << "Could not load clip num " << i << " path: " << dir.getPath(i) << endl;
-                return false;
+            ++it;
+        }
+    }
+    for(const auto &name: folderWatch.poll()) {
+        string path = ofFilePath::join(folderWatch.path(), name);
+        string ext = ofToLower(ofFilePath::getFileExt(name));
+        int slot = slotFromFilename(name);
+        if(slot < 0 || slot >= numSlots)
+            continue;
+        auto idx = static_cast<size_t>(slot);
+        if(ext == "cues") {
+            // only the cues changed, the clip stays loaded. The slot may
+            // hold another clip than the one the sidecar belongs to
+            bool ours = loaded[idx] && ofFilePath::getAbsolutePath(cuePaths[idx], false) ==
+                                       ofFilePath::getAbsolutePath(path, false);
+            if(ours && cues[idx].load(path)) {
+                INFO << "watch -- reloaded cues of slot " << slot << " from " << name << endl;
+                setLoop(idx, cues[idx].loopIn, cues[idx].loopOut);
             }
+            continue;
+        }
+        if(find(clipExtensions.begin(), clipExtensions.end(), ext) == clipExtensions.end())
+            continue;
+        if(ofFile::doesFileExist(path)) {
+            INFO << "watch -- " << name << " changed, reloading slot " << slot << endl;
+            // a resident clip stays resident
+            loadMov(slot, path, false, intraOnLoad, wantResident[idx]);
+            continue;
+        }
+        // a clip renamed within the folder shows up as another file for
+        // the same slot, which is loaded on its own
+        ofDirectory dir(folderWatch.path());
+        for(const auto &e: clipExtensions)
+            dir.allowExt(e);
+        dir.listDir();
+        bool replaced = false;
+        for(size_t i = 0; i < dir.size() && !replaced; i++)
+            replaced = slotFromFilename(dir.getName(i)) == slot;
+        if(replaced || !loaded[idx])
+            continue;
+        INFO << "watch -- " << name << " removed, unloading slot " << slot << endl;
+        if(find(stack.begin(), stack.end(), idx) != stack.end()) {
+            // the player keeps the file open: it plays on until stopped
+            if(find(pendingUnloads.begin(), pendingUnloads.end(), idx) == pendingUnloads.end())
+                pendingUnloads.push_back(idx);
+        } else {
+            unloadSlot(idx);
         }
     }
-    return true;
 }
 
 //--------------------------------------------------------------
 void ofApp::draw() {
-    if(!stack.empty()) {
-        size_t currSlot = stack[stack.size() - 1];
-        auto &mov = movs[currSlot];
-        if(drawclip[currSlot] && (mov.isPaused() || mov.isPlaying())) {
-            mov.draw(draw_x0, draw_y0, draw_width, draw_height);
+    uint64_t t0 = OscInput::now();
+    if(headless)
+        renderHeadless();
+    else
+        drawStack();
+    uint64_t elapsed = OscInput::now() - t0;
+    drawTimes.add(elapsed);
+    statsWindow.drawTime += elapsed;
+    statsWindow.drawMax = max(statsWindow.drawMax, elapsed);
+}
+
+void ofApp::renderHeadless() {
+    renderFbo.begin();
+    ofClear(0, 0, 0, 255);
+    drawStack();
+    renderFbo.end();
+    renderFbo.readToPixels(renderPixels);
+    renderedFrames++;
+    if(frameWriter.isOpen() && !frameWriter.write(renderPixels)) {
+        ofExit(1);
+        return;
+    }
+    if(maxRenderFrames > 0 && renderedFrames >= maxRenderFrames) {
+        INFO << "headless: rendered " << renderedFrames << " frames" << endl;
+        ofExit();
+    }
+}
+
+void ofApp::drawStack() {
+    // The top of the stack is drawn over the slots below it. Lower slots
+    // are only drawn while the ones above are not opaque (fading), at most
+    // numLayers in total
+    if(stack.empty())
+        return;
+    size_t top = stack.size() - 1;
+    size_t first = firstVisible();
+    if(first == top && opacities[stack[top]] >= 1.f) {
+        // a single opaque slot: nothing to blend
+        drawSlot(stack[top], ofRectangle(draw_x0, draw_y0, draw_width, draw_height));
+        return;
+    }
+    ofEnableAlphaBlending();
+    for(size_t i = first; i <= top; i++) {
+        size_t slot = stack[i];
+        if(!drawclip[slot] || opacities[slot] <= 0.f)
+            continue;
+        ofSetColor(255, static_cast<int>(255 * opacities[slot]));
+        drawSlot(slot, i == top ? ofRectangle(draw_x0, draw_y0, draw_width, draw_height)
+                                : fitToWindow(slot));
+    }
+    ofSetColor(255);
+}
+
+void ofApp::drawSlot(size_t slot, const ofRectangle &r) {
+    auto &mov = movs[slot];
+    int scrubFrame = scrubFrames[slot];
+    if(drawclip[slot] && (stepping[slot] || bridgeFrames[slot] >= 0)) {
+        drawStepped(slot, r);
+    } else if(drawclip[slot] && showPreroll[slot]) {
+        prerolls[slot].draw(r.x, r.y, r.width, r.height);
+    } else if(drawclip[slot] && scrubFrame >= 0 && scrubCaches[slot].has(scrubFrame)) {
+        scrubCaches[slot].get(scrubFrame).draw(r.x, r.y, r.width, r.height);
+    } else if(drawclip[slot] && (mov.isPaused() || mov.isPlaying())) {
+        player(slot).draw(r.x, r.y, r.width, r.height);
+    }
+}
+
+void ofApp::drawStepped(size_t slot, const ofRectangle &r) {
+    // The cached frame at the playhead, or the last one shown while it is
+    // being decoded. With blendFrames, the next frame is mixed in by how
+    // far the playhead is past the current one
+    auto &cache = scrubCaches[slot];
+    int frame = stepFrames[slot];
+    if(cache.has(frame))
+        shownFrames[slot] = frame;
+    else if(shownFrames[slot] < 0 || !cache.has(shownFrames[slot]))
+        return;
+    cache.get(shownFrames[slot]).draw(r.x, r.y, r.width, r.height);
+    if(!blendFrames || shownFrames[slot] != frame || durations[slot] <= 0)
+        return;
+    float pos = playheads[slot] / durations[slot] * numFrames[slot];
+    float mix = pos - floor(pos);
+    if(mix <= 0.01f || !cache.has(frame + 1))
+        return;
+    ofColor color = ofGetStyle().color;
+    ofPushStyle();
+    ofEnableAlphaBlending();
+    ofSetColor(color, color.a * mix);
+    cache.get(frame + 1).draw(r.x, r.y, r.width, r.height);
+    ofPopStyle();
+}
+
+void ofApp::fadeSlot(size_t slot, float target, float dur, bool stopWhenDone) {
+    target = ofClamp(target, 0.f, 1.f);
+    fadeTargets[slot] = target;
+    fadeStops[slot] = stopWhenDone;
+    if(dur <= 0) {
+        opacities[slot] = target;
+        fadeRates[slot] = 0;
+    } else {
+        fadeRates[slot] = (target - opacities[slot]) / dur;
+    }
+}
+
+void ofApp::updateFades() {
+    float dt = frameTime();
+    vector<size_t> finished;
+    for(auto slot: stack) {
+        if(fadeRates[slot] == 0)
+            continue;
+        float opacity = opacities[slot] + fadeRates[slot] * dt;
+        if((fadeRates[slot] > 0 && opacity >= fadeTargets[slot]) ||
+           (fadeRates[slot] < 0 && opacity <= fadeTargets[slot])) {
+            opacity = fadeTargets[slot];
+            fadeRates[slot] = 0;
+            if(fadeStops[slot] && opacity <= 0.f)
+                finished.push_back(slot);
+        }
+        opacities[slot] = opacity;
+    }
+    for(auto slot: finished)
+        stopMov(slot);
+}
+
+float ofApp::frameTime() {
+    // duration of the last frame, secs. Fixed when rendering headless
+    if(headless)
+        return 1.f / renderFps;
+    return static_cast<float>(ofGetLastFrameTime());
+}
+
+void ofApp::stepClock() {
+    // Headless playback: advance the playhead of every playing slot by one
+    // frame of the virtual clock and bring its player to the matching
+    // frame, waiting until it has been decoded. The rendered output is
+    // the same regardless of how long decoding takes
+    float dt = frameTime();
+    for(auto slot: stack) {
+        auto &mov = movs[slot];
+        if(!drawclip[slot])
+            continue;
+        if(scrubFrames[slot] >= 0) {
+            if(decodeTargets[slot] < 0)
+                continue;
+            if(waitForFrame(slot) && scrubCaches[slot].enabled())
+                updateScrubCache(slot);
+            else
+                decodeTargets[slot] = -1;
+            continue;
+        }
+        float dur = durations[slot];
+        // synced slots were already set to the master clock by updateSync
+        bool following = synced[slot] && masterClock.valid(OscInput::now());
+        if(!paused[slot] && !following)
+            playheads[slot] += speeds[slot] * dt;
+        if(!loopPlayhead(slot) && (playheads[slot] >= dur || playheads[slot] < 0)) {
+            // finished: pause at the last frame, like a player does
+            playheads[slot] = ofClamp(playheads[slot], 0.f, dur);
+            paused[slot] = true;
+            if(shouldStop[slot]) {
+                drawclip[slot] = false;
+                continue;
+            }
+        }
+        int frame = frameAtTime(slot, playheads[slot]);
+        int shown = clockFrames[slot];
+        if(frame == shown)
+            continue;
+        if(shown < 0 && showPreroll[slot] && frame == frameAtTime(slot, prerollTimes[slot])) {
+            clockFrames[slot] = frame;
+            continue;
+        }
+        if(shown >= 0 && frame == shown + 1)
+            mov.nextFrame();
+        else
+            seekFrame(slot, frame);
+        if(waitForFrame(slot)) {
+            clockFrames[slot] = frame;
+            showPreroll[slot] = false;
+        }
+    }
+}
+
+bool ofApp::waitForFrame(size_t slot) {
+    // blocks until the player of slot has a new frame, at most 2 s
+    const uint64_t timeout = 2000;
+    auto &mov = movs[slot];
+    uint64_t start = ofGetSystemTimeMillis();
+    while(true) {
+        updatePlayer(slot);
+        if(frameNew[slot])
+            return true;
+        if(ofGetSystemTimeMillis() - start > timeout) {
+            WARN << "headless: slot " << slot << " did not deliver a frame in "
+                 << timeout << " ms, frame skipped";
+            return false;
         }
+        ofSleepMillis(1);
     }
 }
 
@@ -542,8 +2885,16 @@ void ofApp::dumpClipsInfo() {
             continue;
 
         cout << "  * slot:" << i
-             << ", path: " << movs[i].getMoviePath()
-             << ", dur:" << movs[i].getDuration()
+             << ", path: " << paths[i]
+             << ", dur:" << durations[i]
+             << ", frames:" << numFrames[i]
+             << ", size:" << widths[i] << "x" << heights[i];
+        const auto &info = clipInfos[i];
+        if(info.valid())
+            cout << ", fps:" << info.frameRate
+                 << ", codec:" << info.codec
+                 << ", keyframes:" << info.numKeyframes();
+        cout << (isOpen[i] ? "" : " (closed)")
              << endl;
     }
 }
@@ -558,9 +2909,16 @@ void ofApp::sendClipInfo(ui32 idx, const string &host, int port) {
     ofxOscMessage msg;
     msg.setAddress("/clipinfo");
     msg.addIntArg(idx);
-    msg.addStringArg(movs[idx].getMoviePath());
-    msg.addFloatArg(movs[idx].getDuration());
-    oscSender.sendMessage(msg);
+    msg.addStringArg(paths[idx]);
+    msg.addFloatArg(durations[idx]);
+    msg.addIntArg(numFrames[idx]);
+    msg.addIntArg(widths[idx]);
+    msg.addIntArg(heights[idx]);
+    // only known once the clip has been indexed
+    const auto &info = clipInfos[idx];
+    msg.addFloatArg(info.frameRate);
+    msg.addStringArg(info.codec);
+    oscOutput.send(msg);
 }
 
 void ofApp::sendClipsInfo() {
@@ -1,7 +1,24 @@
 #pragma once
 
+#include <list>
+#include <set>
+#include <unordered_map>
+
 #include "ofMain.h"
 #include "ofxOsc.h"
+#include "FrameCache.h"
+#include "FrameWriter.h"
+#include "Transcoder.h"
+#include "ClipIndex.h"
+#include "FolderWatch.h"
+#include "OscInput.h"
+#include "OscOutput.h"
+#include "MasterClock.h"
+#include "CueList.h"
+#include "YuvTexture.h"
+#include "SlotDecoder.h"
+#include "OscTrace.h"
+#include "Stats.h"
 
 #define PORT 30003
 
@@ -18,6 +35,60 @@ typedef struct {
     bool needsupdate;
 } ClipStatus;
 
+// A clip which is being opened in the background. The player is polled
+// in ofApp::updateLoads and swapped into its slot once it is ready
+struct LoadJob {
+    size_t slot;
+    string path;
+    ofVideoPlayer mov;
+    bool running;        // false while waiting for a free load slot
+    bool batch;          // part of a /loadfolder batch
+    bool reopen;         // reopening an evicted slot, metadata is already known
+    string cuePath;      // sidecar with the cues of the clip, see CueList
+    uint64_t started;    // ms, ofGetElapsedTimeMillis
+};
+
+// Bookkeeping for a folder ingest, used to report a summary when the
+// last clip of the folder has been loaded (or has failed)
+struct LoadBatch {
+    string path;
+    size_t pending;
+    size_t loaded;
+    size_t failed;
+    uint64_t started;     // ms
+    uint64_t clipTime;    // accumulated load time of all clips, ms
+    uint64_t maxClipTime; // ms
+};
+
+// Counters accumulated between two /stats reports, see ofApp::sendStats
+struct StatsWindow {
+    uint64_t started;       // OscInput::now()
+    uint64_t frames;
+    uint64_t updateTime;    // us, sum of all frames
+    uint64_t updateMax;
+    uint64_t drawTime;
+    uint64_t drawMax;
+    uint64_t dropped;
+    uint64_t duplicated;
+    uint64_t uploaded;      // bytes of frames uploaded to textures
+};
+
+class ofApp;
+typedef void (ofApp::*OscHandler)(const ofxOscMessage &msg);
+
+// An OSC address accepted by the player, see ofApp::registerOscCommands
+struct OscCommand {
+    // values of slotArg, otherwise the index of the slot argument
+    enum { NotCoalesced = -2, CurrentSlot = -1 };
+    string types;       // expected type of each argument: i, f or s
+    size_t minArgs;
+    size_t maxArgs;
+    OscHandler handler;
+    string usage;
+    string doc;
+    int slotArg;        // for idempotent commands, see ofApp::coalesce
+};
+
 class ofApp : public ofBaseApp{
 
 public:
@@ -25,6 +96,57 @@ public:
     void setup();
     void update();
     void draw();
+    void drawStack();
+    void renderHeadless();
+    void exit();
+    void receiveOsc();
+    void applyBatch(const OscBatch &batch);
+    void coalesce(vector<OscBatch> &batches);
+    void addFollower(const string &host, int port);
+    void lead(OscBatch &batch, uint64_t now);
+    void sendLeaderClock(uint64_t now);
+    void reportLatency();
+    void reportBenchmark();
+    void sendStats(uint64_t now);
+    void sendPositions(uint64_t now);
+    void anchorSync(size_t slot, float clipTime);
+    void unsync(size_t slot);
+    void updateSync(uint64_t now);
+    void resetSlotStats(size_t slot);
+    void countNewFrame(size_t slot, uint64_t now);
+    size_t slotResidentMemory(size_t slot);
+    void addOscCommand(const string &address, const string &signature, OscHandler handler,
+                       const string &usage, const string &doc,
+                       int slotArg=OscCommand::NotCoalesced);
+    void registerOscCommands();
+    void handleOscMessage(const ofxOscMessage &msg);
+    bool checkSlot(const string &addr, size_t slot);
+    void oscLoad(const ofxOscMessage &msg);
+    void oscLoadFolder(const ofxOscMessage &msg);
+    void oscPlay(const ofxOscMessage &msg);
+    void oscStop(const ofxOscMessage &msg);
+    void oscClock(const ofxOscMessage &msg);
+    void oscSync(const ofxOscMessage &msg);
+    void oscUnsync(const ofxOscMessage &msg);
+    void oscSyncStatus(const ofxOscMessage &msg);
+    void oscPause(const ofxOscMessage &msg);
+    void oscFade(const ofxOscMessage &msg);
+    void oscOpacity(const ofxOscMessage &msg);
+    void oscSetSpeed(const ofxOscMessage &msg);
+    void oscScrub(const ofxOscMessage &msg);
+    void oscScrubAbs(const ofxOscMessage &msg);
+    void oscSetPos(const ofxOscMessage &msg);
+    void oscSetTime(const ofxOscMessage &msg);
+    void oscCue(const ofxOscMessage &msg);
+    void oscGoCue(const ofxOscMessage &msg);
+    void oscLoop(const ofxOscMessage &msg);
+    void oscLoopCue(const ofxOscMessage &msg);
+    void oscPreroll(const ofxOscMessage &msg);
+    void oscPrefetch(const ofxOscMessage &msg);
+    void oscLatency(const ofxOscMessage &msg);
+    void oscStats(const ofxOscMessage &msg);
+    void oscDump(const ofxOscMessage &msg);
+    void oscQuit(const ofxOscMessage &msg);
 
     void keyPressed(int key);
     void keyReleased(int key);
@@ -39,6 +161,14 @@ public:
     void gotMessage(ofMessage msg);
 
     void calculateDrawCoords();
+    ofRectangle fitToWindow(size_t slot);
+    void drawSlot(size_t slot, const ofRectangle &r);
+    void drawStepped(size_t slot, const ofRectangle &r);
+    void fadeSlot(size_t slot, float target, float dur, bool stopWhenDone);
+    void updateFades();
+    float frameTime();
+    void stepClock();
+    bool waitForFrame(size_t slot);
     void printOscApi();
     void printKeyboardShortcuts();
     bool playClip(size_t slot, float speed=1.f, float offset=0.f, bool paused=false,
@@ -51,8 +181,64 @@ public:
             int stopWhenFinished = numargs >= 5 ? msg.getArgAsInt32(4) : 1;
             int stopPrevious = numargs >= 6 ? msg.getArgAsInt32(5) : 0;
      */
-    bool loadMov(int slot, string const &path);
-    bool loadFolder(string const &path);
+    // Queues path to be loaded into slot. Returns false if the request was
+    // rejected right away, the outcome of the load itself is reported
+    // later via /loaded. With intra, an intra-only copy of the clip is
+    // loaded instead, transcoding it first if it is not in the cache
+    // With ram, every frame of the clip is decoded once into a frame store,
+    // see makeResident. source: the clip path is a copy of (a transcode),
+    // its cues are read next to source
+    bool loadMov(int slot, string const &path, bool batch=false, bool intra=false,
+                 bool ram=false, string const &source="");
+    void updateLoads();
+    void finishLoad(LoadJob &job);
+    void registerClip(size_t idx, const string &path, const string &cuePath, uint64_t started);
+    void finishBatchItem(size_t slot, const string &path, uint64_t started, bool ok);
+    void reportBatch();
+    size_t residentBytes(size_t slot);
+    bool makeResident(size_t slot);
+    void fillFrameStores();
+    void sendLoaded(size_t slot, bool ok);
+    void sendSeeked(size_t slot, int frame);
+    void cancelLoad(size_t idx);
+    void unloadSlot(size_t slot);
+    bool ensureOpen(size_t slot);
+    void reopenMov(size_t slot);
+    size_t slotMemory(size_t slot);
+    void evictSlots();
+    int frameAtTime(size_t slot, float time);
+    float timeAtFrame(size_t slot, int frame);
+    int currentFrame(size_t slot);
+    void seekFrame(size_t slot, int frame);
+    void parkAtPreroll(size_t slot);
+    void updatePrerolls();
+    void copyFrame(size_t slot, ofFbo &fbo);
+    void updatePlayer(size_t slot);
+    void presentFrame(size_t slot);
+    void startDecoder(size_t slot);
+    void stopDecoder(size_t slot);
+    size_t firstVisible();
+    void updateVisibility(uint64_t now);
+    void unpark(size_t slot, uint64_t now);
+    const ofBaseDraws &player(size_t slot);
+    void updateLoop(size_t slot);
+    void wrapLoop(size_t slot);
+    void endBridge(size_t slot);
+    int loopLead(size_t slot);
+    void setupLoopLead(size_t slot);
+    bool loopPlayhead(size_t slot);
+    void setLoop(size_t slot, float in, float out);
+    void setupFrameCache(size_t slot, size_t frames);
+    void scrubTo(size_t slot, int frame);
+    void jumpTo(size_t slot, float time);
+    void applySpeed(size_t slot);
+    void stepSlot(size_t slot, uint64_t now);
+    float slotTime(size_t slot);
+    void updateScrubCache(size_t slot);
+    // With watch, the folder is watched afterwards and changed clips are
+    // reloaded, see updateWatch
+    bool loadFolder(string const &path, bool watch=false);
+    void updateWatch();
     void dumpClipsInfo();
 
     size_t currentSlot() {
@@ -67,6 +253,22 @@ public:
         // movs[slot].stop();
         movs[slot].setPaused(true);
         drawclip[slot] = false;
+        showPreroll[slot] = false;
+        bridgeFrames[slot] = -1;
+        opacities[slot] = 1.f;
+        fadeRates[slot] = 0;
+        clockFrames[slot] = -1;
+        stepping[slot] = false;
+        hiddenSince[slot] = 0;
+        parkedTimes[slot] = -1;
+        if(decoders[slot])
+            decoders[slot]->setActive(true);
+        scrubFrames[slot] = -1;
+        decodeTargets[slot] = -1;
+        // seek back to the warm-start frame now, so that the next /play
+        // does not need to wait for the decoder
+        if(usePreroll)
+            parkAtPreroll(slot);
 
         if(slot == stack[stack.size()-1])
             stack.pop_back();
@@ -79,9 +281,11 @@ public:
             ofxOscMessage msg;
             msg.setAddress("/stop");
             msg.addIntArg(slot);
-            oscSender.sendMessage(msg);
-            lastOscMsg = msg;
+            oscOutput.send(msg);
         }
+        reportedTimes[slot] = -1;
+        lastPositionSlot = numSlots;
+        unsync(slot);
     }
 
     void sendClipInfo(ui32 idx, const string &host, int port);
@@ -97,16 +301,162 @@ public:
     vector<bool> shouldStop;
     vector<bool> needsUpdate;
     vector<float> durations;
+    // clip metadata, known for every loaded slot, open or not
+    vector<string> paths;
+    vector<int> numFrames;
+    vector<int> widths;
+    vector<int> heights;
+    // only the most recently used slots keep their decoder open, see evictSlots
+    vector<bool> isOpen;
+    vector<uint64_t> lastUsed;      // frame number
+    vector<pair<size_t, ofxOscMessage>> deferred;   // waiting for their slot to reopen
+    size_t maxOpen;                 // 0: no limit
+    size_t memBudgetMB;             // 0: no limit
+    vector<float> opacities;
+    vector<float> fadeTargets;
+    vector<float> fadeRates;        // opacity change per sec, 0 when not fading
+    vector<bool> fadeStops;         // stop the slot once faded out
+    size_t numLayers;               // max. number of stacked slots drawn at once
+    vector<ofFbo> prerolls;         // start frame of each slot, see parkAtPreroll
+    vector<float> prerollTimes;
+    vector<bool> showPreroll;       // draw the preroll until the player has a new frame
+    // frames uploaded plane by plane, see updatePlayer
+    bool yuvUpload;
+    ofShader yuvShader;
+    vector<YuvTexture> yuvTextures;
+    uint64_t uploadedBytes;
+    vector<bool> frameNew;          // updatePlayer brought a new frame
+    // frames fetched on a thread per slot, see presentFrame
+    bool decodeThreads;
+    vector<unique_ptr<SlotDecoder>> decoders;
+    vector<deque<DecodedFrame>> presentQueues;
+    uint64_t numSkippedFrames;
+    // slots covered by the ones above, see updateVisibility
+    uint64_t parkAfter;             // us
+    vector<uint64_t> hiddenSince;   // 0: visible
+    vector<float> parkedTimes;      // clip time when parked, -1: not parked
+    vector<uint64_t> parkedAt;
+    // cue points and loops, see wrapLoop
+    vector<CueList> cues;
+    vector<string> cuePaths;        // sidecar the cues of each slot are read from
+    size_t loopLeadFrames;          // frames at the loop start kept decoded, to cover the wrap
+    vector<int> bridgeFrames;       // frame the player seeks to at the wrap, -1 if not wrapping
+    vector<bool> bridgeReady;       // the player has delivered bridgeFrames
+    vector<size_t> prerollQueue;    // slots waiting for their start frame to be decoded
+    bool usePreroll;
+    vector<FrameCache> scrubCaches;
+    vector<int> scrubFrames;        // frame shown while scrubbing, -1 if not scrubbing
+    vector<int> decodeTargets;      // frame the player was last asked to decode, -1 if none
+    vector<int> seekTargets;        // seek to report with /seeked once it lands, -1 if none
+    vector<float> frameTimes;       // clip secs of the frame updatePlayer brought last
+    size_t scrubCacheFrames;        // per slot, 0 disables the cache
+    size_t scrubCacheMB;            // per slot
+    Transcoder transcoder;
+    vector<string> transcoding;     // source being transcoded for each slot, if any
+    bool intraOnLoad;               // transcode clips loaded via loadFolder
+    string intraCacheDir;           // empty: .intracache next to each clip
+    // metadata and keyframes of clips, kept on disk between runs
+    bool useClipIndex;
+    ClipIndex clipIndex;
+    string clipIndexDir;            // empty: .clipindex next to each clip
+    vector<ClipInfo> clipInfos;     // invalid until the clip has been indexed
+    vector<int> runEnds;            // frame a keyframe run of the scrub cache decodes to, -1 if none
+    // short clips kept entirely as decoded frames, see fillFrameStores
+    vector<bool> wantResident;      // requested with the last load of the slot
+    vector<bool> resident;          // admitted: its frame store holds every frame
+    vector<bool> residentFull;      // every frame decoded, the player is not used anymore
+    float residentBelow;            // clips shorter than this (secs) are made resident, 0: off
+    size_t residentMB;              // for all resident slots together
+    list<LoadJob> loadJobs;
+    FolderWatch folderWatch;
+    uint64_t watchSettle;           // ms a changed file must be left alone before it is reloaded
+    vector<size_t> pendingUnloads;  // removed from the watched folder while on screen
+    LoadBatch loadBatch;
+    size_t maxLoads;         // max. number of clips being opened at once
+    uint64_t loadTimeout;    // ms
     size_t numSlots;
     int oscPort;
     bool debugging;
     int draw_x0, draw_y0, draw_width, draw_height;
-    ofxOscMessage lastOscMsg;
+    // headless: rendered offscreen at a fixed frame rate, independent of
+    // wall time. Players are paused and stepped to the frame of the
+    // virtual playhead, waiting for each frame to be decoded
+    bool headless;
+    int renderFps;
+    uint64_t maxRenderFrames;       // quit after this many frames, 0: no limit
+    uint64_t renderedFrames;
+    string renderOutput;            // path, named pipe or - (stdout). Empty: no output
+    ofFbo renderFbo;
+    ofPixels renderPixels;
+    FrameWriter frameWriter;
+    vector<float> playheads;        // secs
+    vector<int> clockFrames;        // frame last shown by the clock, -1: none
 
     ui32 oscOutPort;
     string oscOutHost;
 
-    ofxOscReceiver oscReceiver;
-    ofxOscSender oscSender;
+    unordered_map<string, OscCommand> oscCommands;
+    vector<string> oscCommandOrder;     // registration order, for the manual
+    OscInput oscInput;
+    multimap<uint64_t, OscBatch> scheduled;     // bundles with a future timetag, by due time
+    bool coalesceOsc;               // collapse repeated idempotent commands within a frame
+    uint64_t numCoalesced;
+    // OSC latencies, in us. A frame counts as presented when the next
+    // update starts, that is, after the buffer swap
+    Stats receiveToApply;
+    Stats applyToPresent;
+    Stats scheduleError;            // |apply - due| for timetagged bundles
+    vector<uint64_t> appliedAt;     // apply times of the batches of the current frame
+    // per frame timings, in us, and counters. Reported at exit with --bench
+    Stats updateTimes;
+    Stats drawTimes;
+    Stats frameIntervals;
+    uint64_t numSeeks;
+    uint64_t numDroppedFrames;      // frames which took more than 1.5 periods
+    uint64_t lastUpdateStart;
+    uint64_t benchStart;
+    bool benchmark;
+    string replayPath;              // OSC trace sent to our own port, see OscReplayer
+    OscReplayer replayer;
+    uint64_t replayDoneAt;
+    // /stats telemetry, sent statsRate times per sec to the oscout address
+    float statsRate;                // 0: off
+    StatsWindow statsWindow;
+    vector<int> statsFrames;        // frame of each slot when the window started, -1: seeked since
+    vector<uint64_t> newFrameAt;    // last time each slot's player delivered a frame
+    vector<uint64_t> slotDuplicated;    // clip frames shown twice or more, in this window
+    string recordPath;              // incoming OSC is recorded here as a trace
+    ofstream oscRecord;
+    uint64_t recordStart;
+    OscOutput oscOutput;
+    // outbound /play position feed, see sendPositions
+    float positionRate;             // reports per sec, 0: every frame
+    float positionDelta;            // secs a slot must move to be reported again
+    bool positionBundle;            // report every visible slot, in one bundle
+    uint64_t lastPositionAt;
+    size_t lastPositionSlot;        // numSlots: none
+    vector<float> reportedTimes;    // -1: not reported since it was (re)started
+    // external master clock, see updateSync
+    MasterClock masterClock;
+    bool followClock;               // /play locks its slot to the clock
+    uint64_t batchTime;             // due or arrival time of the batch being applied
+    vector<bool> synced;
+    vector<double> syncOffsets;     // clock time at which the clip is at 0
+    vector<float> syncErrors;       // secs, positive: ahead of the clock
+    vector<float> syncFactors;      // speed correction applied to the player
+    vector<uint64_t> syncSeekAt;    // last corrective seek
+    vector<uint64_t> syncSpeedAt;   // last change of syncFactors
+    // reverse and slow playback, see applySpeed
+    float stepBelow;                // speeds below this (and < 0) are stepped
+    size_t stepCacheFrames;         // frame cache of a stepped slot, if not set up for scrubbing
+    bool blendFrames;               // mix consecutive frames when stepping slowly
+    vector<bool> stepping;
+    vector<int> stepFrames;         // frame at the playhead of a stepped slot
+    vector<int> shownFrames;        // frame last drawn of a stepped slot
+    vector<uint64_t> steppedAt;     // update time of the last stepSlot, it runs once per frame
+    // leader of other instances on this host, see lead
+    vector<unique_ptr<OscOutput>> followers;
+    uint64_t syncLead;              // us, how far ahead commands are scheduled
+    uint64_t leaderStart;           // the leader's clock is 0 here
 
 };